@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "utils.h"
+#include "anagram.h"
+#include "anaindex.h"
+#include "phrase.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing benchmark runs.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Times the index build over 1..max_threads threads and checks every result is
+ * identical to the single-threaded build (compared as serialized images).
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param max_threads Largest thread count to try.
+ */
+static void bench_build(wordView *words, int n, int max_threads) {
+    double t0 = now();
+    anagramIndex *reference = make_anagram_index(words, n);
+    sort_anagram_groups(reference);
+    double serial = now() - t0;
+    size_t ref_size;
+    char *ref_image = serialize_anagram_index(reference, &ref_size);
+    printf("%-10s %10s %10s %10s\n", "threads", "seconds", "speedup", "identical");
+    printf("%-10s %10.4f %10.2f %10s\n", "serial", serial, 1.0, "-");
+
+    for (int t = 1; t <= max_threads; t++) {
+        double best = 0;
+        int identical = 1;
+        for (int rep = 0; rep < 3; rep++) { // Best of three
+            t0 = now();
+            anagramIndex *index = make_anagram_index_parallel(words, n, t);
+            double elapsed = now() - t0;
+            if (rep == 0 || elapsed < best) best = elapsed;
+            size_t size;
+            char *image = serialize_anagram_index(index, &size);
+            identical &= size == ref_size && memcmp(image, ref_image, size) == 0;
+            free(image);
+            free_anagram_index(index);
+        }
+        printf("%-10d %10.4f %10.2f %10s\n", t, best, serial / best, identical ? "yes" : "NO");
+    }
+    free(ref_image);
+    free_anagram_index(reference);
+}
+
+/**
+ * Counts the words that can be spelled from a set of letters the obvious way: tally
+ * each word's letters and check them against the set, for every word in the list.
+ * This is what ana_sub_anagrams has to agree with.
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param letters The letters to spell from.
+ * @return Number of words that fit.
+ */
+static int brute_sub_anagrams(wordView *words, int n, const char *letters) {
+    int have[26] = {0};
+    for (const unsigned char *c = (const unsigned char *)letters; *c; c++) {
+        unsigned letter = (*c | 0x20) - 'a';
+        if (letter < 26) have[letter]++;
+    }
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int need[26] = {0}, fits = 1, length = 0;
+        for (int j = 0; j < words[i].len && fits; j++) {
+            unsigned letter = ((unsigned char)words[i].str[j] | 0x20) - 'a';
+            if (letter >= 26) continue;
+            length++;
+            fits = ++need[letter] <= have[letter];
+        }
+        found += fits && length > 0;
+    }
+    return found;
+}
+
+/**
+ * Times sub-anagram queries through the index against a brute-force scan of the
+ * word list, and checks both find the same number of words for every query.
+ * The queries are words spread evenly through the list.
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param num_queries Number of queries to run.
+ */
+static void bench_sub_anagrams(wordView *words, int n, int num_queries) {
+    anagramIndex *built = make_anagram_index(words, n);
+    size_t size;
+    char *image = serialize_anagram_index(built, &size);
+    free_anagram_index(built);
+    anaIndex *index = image ? anagram_index_from_image(image, size) : NULL;
+    uint32_t *matches = malloc((index ? index->header->num_groups + 1 : 1) * sizeof(uint32_t));
+    if (!index || !matches) {
+        fprintf(stderr, "Failed to build anagram index\n");
+        close_anagram_index(index);
+        free(matches);
+        return;
+    }
+    if (num_queries > n) num_queries = n;
+
+    double index_time = 0, brute_time = 0;
+    long long index_words = 0, brute_words = 0;
+    int mismatches = 0;
+    for (int q = 0; q < num_queries; q++) {
+        const char *query = words[(long long)q * n / num_queries].str;
+        double t0 = now();
+        int num_groups = ana_sub_anagrams(index, word_signature(query), 1, matches,
+                                          index->header->num_groups);
+        int found = 0;
+        for (int m = 0; m < num_groups; m++) found += index->groups[matches[m]].word_count;
+        double t1 = now();
+        int expected = brute_sub_anagrams(words, n, query);
+        brute_time += now() - t1;
+        index_time += t1 - t0;
+        index_words += found;
+        brute_words += expected;
+        mismatches += found != expected;
+    }
+    printf("%-12s %14s %14s\n", "method", "ms/query", "words found");
+    printf("%-12s %14.4f %14lld\n", "brute force", brute_time * 1e3 / num_queries, brute_words);
+    printf("%-12s %14.4f %14lld\n", "index", index_time * 1e3 / num_queries, index_words);
+    printf("speedup %.1fx, %s\n", brute_time / index_time,
+           mismatches ? "RESULTS DIFFER" : "results identical");
+    free(matches);
+    close_anagram_index(index);
+}
+
+/**
+ * Makes a test phrase of 15 to 25 letters by joining random words from the list,
+ * so every phrase is known to have at least one answer.
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param state Random number generator state (a simple LCG, advanced in place).
+ * @param phrase Buffer of at least 128 characters for the phrase.
+ */
+static void make_test_phrase(wordView *words, int n, unsigned long long *state, char *phrase) {
+    while (1) {
+        int letters = 0, pos = 0;
+        while (letters < 15) {
+            *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+            wordView *w = &words[(*state >> 33) % n];
+            if (w->len == 0 || pos + w->len + 2 > 128) break;
+            if (pos > 0) phrase[pos++] = ' ';
+            memcpy(phrase + pos, w->str, w->len);
+            pos += w->len;
+            letters += sig_length(word_signature(w->str));
+        }
+        phrase[pos] = '\0';
+        if (letters >= 15 && letters <= 25) return;
+    }
+}
+
+/**
+ * Times the phrase solver on random 15-25 letter phrases, with and without
+ * memoizing dead ends, under the default search limits.
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param num_phrases Number of phrases to solve.
+ */
+static void bench_phrases(wordView *words, int n, int num_phrases) {
+    anagramIndex *built = make_anagram_index(words, n);
+    size_t size;
+    char *image = serialize_anagram_index(built, &size);
+    free_anagram_index(built);
+    anaIndex *index = image ? anagram_index_from_image(image, size) : NULL;
+    char (*phrases)[128] = malloc(num_phrases * sizeof(*phrases));
+    if (!index || !phrases) {
+        fprintf(stderr, "Failed to build anagram index\n");
+        close_anagram_index(index);
+        free(phrases);
+        return;
+    }
+    unsigned long long state = 42;
+    for (int p = 0; p < num_phrases; p++) make_test_phrase(words, n, &state, phrases[p]);
+
+    printf("%-10s %12s %12s %14s %12s %10s\n", "memo", "ms/phrase", "phrases", "nodes", "memo hits", "limited");
+    for (int memoize = 1; memoize >= 0; memoize--) {
+        phraseOptions options;
+        default_phrase_options(&options);
+        options.memoize = memoize;
+        long long found = 0, nodes = 0, memo_hits = 0;
+        int limited = 0;
+        double t0 = now();
+        for (int p = 0; p < num_phrases; p++) {
+            phraseResults *results = solve_phrase(index, phrases[p], &options);
+            if (!results) break;
+            found += results->count;
+            nodes += results->nodes;
+            memo_hits += results->memo_hits;
+            limited += results->truncated;
+            free_phrase_results(results);
+        }
+        double elapsed = now() - t0;
+        printf("%-10s %12.3f %12lld %14lld %12lld %10d\n", memoize ? "on" : "off",
+               elapsed * 1e3 / num_phrases, found, nodes, memo_hits, limited);
+    }
+    phraseOptions limits;
+    default_phrase_options(&limits);
+    printf("(limits: %d phrases, %d words of %d+ letters, %.0f s per phrase)\n",
+           limits.max_results, limits.max_words, limits.min_word_length, limits.max_seconds);
+    free(phrases);
+    close_anagram_index(index);
+}
+
+/**
+ * Checks that words with more than 15 of a letter (whose signatures saturate) are
+ * left out of the index rather than grouped with words that aren't their anagrams,
+ * by the serial build and by the parallel one.
+ * @return 0 if both builds get it right, 1 if not.
+ */
+static int check_saturated(void) {
+    char e16f15[32], e15f16[32], listen[] = "listen", silent[] = "silent";
+    memset(e16f15, 'e', 16); memset(e16f15 + 16, 'f', 15); e16f15[31] = '\0';
+    memset(e15f16, 'e', 15); memset(e15f16 + 15, 'f', 16); e15f16[31] = '\0';
+    wordView words[] = {{e16f15, 31}, {e15f16, 31}, {listen, 6}, {silent, 6}};
+    int status = 0;
+    for (int parallel = 0; parallel <= 1; parallel++) {
+        anagramIndex *index = parallel ? make_anagram_index_parallel(words, 4, 2) : make_anagram_index(words, 4);
+        int ok = index->num_groups == 1 && index->num_saturated == 2 &&
+                 index->head && index->head->group_size == 2;
+        printf("%-10s %d groups, %d words left out: %s\n", parallel ? "parallel" : "serial",
+               index->num_groups, index->num_saturated, ok ? "ok" : "WRONG");
+        status |= !ok;
+        free_anagram_index(index);
+    }
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 2 && strcmp(argv[1], "check") == 0) return check_saturated();
+    if (argc < 3 || (strcmp(argv[1], "build") != 0 && strcmp(argv[1], "sub") != 0 &&
+                     strcmp(argv[1], "phrase") != 0)) {
+        fprintf(stderr, "Usage: %s build <wordlist> [max threads]\n", argv[0]);
+        fprintf(stderr, "       %s sub <wordlist> [queries]\n", argv[0]);
+        fprintf(stderr, "       %s phrase <wordlist> [phrases]\n", argv[0]);
+        fprintf(stderr, "       %s check\n", argv[0]);
+        return 1;
+    }
+    wordList *list = load_word_list(argv[2]);
+    if (!list) return 1;
+
+    if (strcmp(argv[1], "sub") == 0) {
+        int num_queries = argc > 3 ? atoi(argv[3]) : 200;
+        if (num_queries < 1) num_queries = 1;
+        printf("Sub-anagram search over %s (%d words, %d queries)\n", argv[2], list->count, num_queries);
+        bench_sub_anagrams(list->words, list->count, num_queries);
+        free_word_list(list);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "phrase") == 0) {
+        int num_phrases = argc > 3 ? atoi(argv[3]) : 50;
+        if (num_phrases < 1) num_phrases = 1;
+        printf("Phrase anagrams over %s (%d words, %d phrases of 15-25 letters)\n",
+               argv[2], list->count, num_phrases);
+        bench_phrases(list->words, list->count, num_phrases);
+        free_word_list(list);
+        return 0;
+    }
+
+    int max_threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1) max_threads = 1;
+    printf("Index build over %s (%d words)\n", argv[2], list->count);
+    bench_build(list->words, list->count, max_threads);
+
+    free_word_list(list);
+    return 0;
+}
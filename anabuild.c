@@ -0,0 +1,45 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "utils.h"
+#include "anagram.h"
+#include "anaindex.h"
+
+/**
+ * Builds an anagram index file from a word list, once, so anaquery can mmap it
+ * instead of re-reading and re-grouping the word list on every run.
+ * With -t, the groups are built by that many threads (0 means one per CPU).
+ */
+int main(int argc, char *argv[]) {
+    int num_threads = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        if (opt == 't') num_threads = atoi(optarg);
+        else break;
+    }
+    if (argc - optind != 2 || opt == '?') {
+        fprintf(stderr, "Usage: %s [-t threads] <wordlist> <index file>\n", argv[0]);
+        return 1;
+    }
+    const char *wordlist = argv[optind], *index_file = argv[optind + 1];
+
+    // Load the word list
+    wordList *word_list = load_word_list(wordlist);
+    if (!word_list) return 1;
+    int num_words = word_list->count;
+
+    // Group the words and write the index image out
+    anagramIndex *anagram_index = num_threads == 1 ? make_anagram_index(word_list->words, num_words)
+                                                   : make_anagram_index_parallel(word_list->words, num_words, num_threads);
+    if (anagram_index->num_saturated > 0)
+        fprintf(stderr, "Warning: left out %d words with more than 15 of a letter\n", anagram_index->num_saturated);
+    int status = save_anagram_index(anagram_index, index_file);
+    if (status == 0)
+        printf("Indexed %d words in %d anagram groups into %s\n", num_words - anagram_index->num_saturated,
+               anagram_index->num_groups, index_file);
+
+    free_anagram_index(anagram_index);
+    free_word_list(word_list);
+    return status == 0 ? 0 : 1;
+}
@@ -9,6 +9,8 @@
 #include <time.h>
 #include <ctype.h>
 #include "utils.h"
+#include <pthread.h>
+#include <unistd.h>
 
 /**
  * Frees all memory used by the anagram list, including the words and sorted keys.
@@ -270,18 +272,569 @@ void process(nodePrimary *head, int **x, double **H, int *n) {
 
 /**
  * Builds a list of anagram groups from an array of words.
- * For each word, computes its sorted key and adds it to the appropriate group.
- * Groups are sorted by key length and then alphabetically.
+ * Groups are found through a hash-indexed anagramIndex, then copied out in
+ * length-then-alphabetical order into a standalone list the caller frees with
+ * free_anagram_list, exactly as before. Words with more than 15 of a letter are left
+ * out (see index_push_sig).
  * @param words Array of input words.
  * @param n Number of words in the array.
  * @return Pointer to the head of the anagram list.
  */
 nodePrimary *make_anagram_list(char **words, int n) {
-    nodePrimary *head = NULL;
-    for (int i = 0; i < n; i++) {
-        char *sorted_word = sorted(words[i]);     // Get sorted key
-        push_word(&head, sorted_word, words[i]);  // Add to list
-        free(sorted_word);                        // Free temporary key
+    anagramIndex *index = create_anagram_index(n / 2);
+    for (int i = 0; i < n; i++)
+        index_push_sig(index, word_signature(words[i]), words[i]);
+    nodePrimary *head = NULL, *tail = NULL;
+    for (nodePrimary *cur = sort_anagram_groups(index); cur; cur = cur->next) {
+        nodePrimary *copy = create_node_primary(cur->sorted_key);
+        copy->sig = cur->sig;
+        copy->group_size = cur->group_size;
+        free(copy->words); // Replace the sentinel with a copy of the words
+        node *word_tail = copy->words = create_node(cur->words->word);
+        for (node *word = cur->words->next; word; word = word->next) push(&word_tail, word->word);
+        if (tail) tail->next = copy; else head = copy;
+        tail = copy;
     }
+    free_anagram_index(index);
     return head;
+}
+
+/**
+ * Computes the letter-count signature of a word without allocating anything.
+ * Like sorted(), it ignores case and anything that isn't a letter, so two words
+ * have the same signature exactly when sorted() gives them the same key, as long
+ * as neither has more than 15 of one letter (see sig_exact).
+ * @param word The input word.
+ * @return The word's signature.
+ */
+anagramSig word_signature(const char *word) {
+    anagramSig sig = {0, 0};
+    uint64_t len = 0;
+    for (const unsigned char *c = (const unsigned char *)word; *c; c++) {
+        unsigned letter = (*c | 0x20) - 'a'; // Folds case; non-letters land outside 0-25
+        if (letter >= 26) continue;
+        int shift = letter < 13 ? 48 - 4 * letter : 48 - 4 * (letter - 13);
+        uint64_t *half = letter < 13 ? &sig.lo : &sig.hi;
+        if (((*half >> shift) & 0xF) != 0xF) *half += (uint64_t)1 << shift; // Saturate at 15
+        len++;
+    }
+    if (len > 0xFFF) len = 0xFFF;
+    sig.lo |= len << 52;
+    return sig;
+}
+
+/**
+ * Returns the number of letters a signature stands for (the sorted key's length).
+ * @param sig The signature.
+ * @return Letter count.
+ */
+int sig_length(anagramSig sig) {
+    return (int)(sig.lo >> 52);
+}
+
+/**
+ * Checks that no letter count of a signature saturated at 15, by adding the counts
+ * up and comparing them with the length (which counts every letter).
+ * @param sig The signature.
+ * @return 1 if the signature holds the word's exact letter counts, 0 if not.
+ */
+int sig_exact(anagramSig sig) {
+    int total = 0;
+    for (int shift = 0; shift < 52; shift += 4) {
+        total += (int)((sig.lo >> shift) & 0xF) + (int)((sig.hi >> shift) & 0xF);
+    }
+    return total == sig_length(sig);
+}
+
+/**
+ * Writes the sorted key of a signature (e.g., "aet") into a caller-supplied buffer.
+ * This is how groups get a printable key without ever keeping sorted() strings around.
+ * @param sig The signature.
+ * @param buffer Space for at least sig_length(sig) + 1 characters.
+ * @return Length of the key written (not counting the terminating NUL).
+ */
+int sig_to_key(anagramSig sig, char *buffer) {
+    int pos = 0;
+    for (int letter = 0; letter < 26; letter++) {
+        uint64_t half = letter < 13 ? sig.lo : sig.hi;
+        int count = (half >> (letter < 13 ? 48 - 4 * letter : 48 - 4 * (letter - 13))) & 0xF;
+        while (count--) buffer[pos++] = 'a' + letter;
+    }
+    buffer[pos] = '\0';
+    return pos;
+}
+
+/**
+ * Returns which letters a signature contains, as a 26-bit mask (bit 0 is 'a').
+ * One AND of two masks tells whether a word could possibly be spelled from a set
+ * of letters, before any counts are compared.
+ * @param sig The signature.
+ * @return Mask with bit i set when letter 'a' + i occurs at least once.
+ */
+uint32_t sig_letter_mask(anagramSig sig) {
+    uint32_t mask = 0;
+    for (int letter = 0; letter < 26; letter++) {
+        uint64_t half = letter < 13 ? sig.lo : sig.hi;
+        if ((half >> (letter < 13 ? 48 - 4 * letter : 48 - 4 * (letter - 13))) & 0xF) mask |= 1u << letter;
+    }
+    return mask;
+}
+
+#define POOL_BLOCK_SIZE (64 * 1024)
+
+/*
+ * A block of the index's bump allocator. Groups, word nodes and keys are carved out
+ * of these, so building an index costs a handful of mallocs instead of several per word.
+ */
+struct poolBlock {
+    poolBlock *next;          // Previously filled block
+    size_t used;              // Bytes handed out so far
+    size_t size;              // Bytes available in data
+    char data[];              // The memory itself
+};
+
+/**
+ * Hands out memory from the index's pool, starting a new block when the current one is full.
+ * Everything is freed together by free_anagram_index.
+ * @param index The index that owns the memory.
+ * @param bytes Number of bytes needed.
+ * @return Pointer to 8-byte aligned memory, or exits if memory allocation fails.
+ */
+static void *pool_alloc(anagramIndex *index, size_t bytes) {
+    bytes = (bytes + 7) & ~(size_t)7;
+    poolBlock *block = index->pool;
+    if (!block || block->used + bytes > block->size) {
+        size_t size = bytes > POOL_BLOCK_SIZE ? bytes : POOL_BLOCK_SIZE;
+        block = malloc(sizeof(poolBlock) + size);
+        if (!block) {
+            perror("Memory allocation failed for index pool");
+            exit(1);
+        }
+        block->next = index->pool;
+        block->used = 0;
+        block->size = size;
+        index->pool = block;
+    }
+    void *ptr = block->data + block->used;
+    block->used += bytes;
+    return ptr;
+}
+
+/**
+ * Creates an empty anagram index with room for roughly the given number of groups.
+ * The table is kept at most half full, so the capacity starts at the next power of two
+ * above twice the expected group count.
+ * @param expected_groups Rough number of groups the caller expects (can be 0).
+ * @return Pointer to the new index, or exits if memory allocation fails.
+ */
+anagramIndex *create_anagram_index(int expected_groups) {
+    anagramIndex *index = malloc(sizeof(anagramIndex));
+    if (!index) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    index->capacity = 16;
+    while (index->capacity < 2 * expected_groups) index->capacity *= 2;
+    index->slots = calloc(index->capacity, sizeof(indexSlot));
+    if (!index->slots) {
+        perror("Memory allocation failed for index slots");
+        exit(1);
+    }
+    index->num_groups = 0;
+    index->num_saturated = 0;
+    index->head = index->tail = NULL;
+    index->pool = NULL;
+    return index;
+}
+
+/**
+ * Frees an anagram index: its hash table and the pool holding its groups and keys.
+ * The words themselves belong to the caller (the index only points at them).
+ * @param index The index to free.
+ */
+void free_anagram_index(anagramIndex *index) {
+    if (!index) return;
+    for (poolBlock *block = index->pool, *next; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    free(index->slots);
+    free(index);
+}
+
+/**
+ * Finds the slot holding a signature, or the empty slot where it would go.
+ * Uses linear probing; each probe is two integer compares.
+ * @param slots The slot array to probe.
+ * @param capacity Number of slots (a power of two).
+ * @param sig The signature to look for.
+ * @return Pointer to the matching or empty slot.
+ */
+static indexSlot *probe(indexSlot *slots, int capacity, anagramSig sig) {
+    unsigned int mask = capacity - 1;
+    for (unsigned int i = hash_sig(sig) & mask; ; i = (i + 1) & mask) {
+        indexSlot *slot = &slots[i];
+        if (!slot->group || sig_equal(slot->sig, sig)) return slot;
+    }
+}
+
+/**
+ * Doubles the size of the hash table and re-inserts every group.
+ * @param index The index to grow.
+ */
+static void grow_index(anagramIndex *index) {
+    int new_capacity = index->capacity * 2;
+    indexSlot *new_slots = calloc(new_capacity, sizeof(indexSlot));
+    if (!new_slots) {
+        perror("Memory allocation failed for index slots");
+        exit(1);
+    }
+    for (int i = 0; i < index->capacity; i++) {
+        indexSlot *old = &index->slots[i];
+        if (old->group) *probe(new_slots, new_capacity, old->sig) = *old;
+    }
+    free(index->slots);
+    index->slots = new_slots;
+    index->capacity = new_capacity;
+}
+
+/**
+ * Stores an existing group in the index's table and appends it to the group list.
+ * @param index The index to add to.
+ * @param slot The empty slot probe() found for the group's signature.
+ * @param group The group to add.
+ */
+static void link_group(anagramIndex *index, indexSlot *slot, nodePrimary *group) {
+    slot->sig = group->sig;
+    slot->group = group;
+    group->next = NULL;
+    if (index->tail) index->tail->next = group; else index->head = group;
+    index->tail = group;
+    if (++index->num_groups * 2 > index->capacity) grow_index(index); // Keep load under 1/2
+}
+
+/**
+ * Looks up the anagram group for a signature.
+ * @param index The index to search.
+ * @param sig The signature to look for.
+ * @return Pointer to the matching group, or NULL if there is none.
+ */
+nodePrimary *index_find_sig(anagramIndex *index, anagramSig sig) {
+    return probe(index->slots, index->capacity, sig)->group;
+}
+
+/**
+ * Looks up the anagram group for a sorted key.
+ * @param index The index to search.
+ * @param sorted_key The sorted key to look for (e.g., "aet").
+ * @return Pointer to the matching group, or NULL if there is none.
+ */
+nodePrimary *index_find_group(anagramIndex *index, const char *sorted_key) {
+    return index_find_sig(index, word_signature(sorted_key));
+}
+
+/**
+ * Adds a word to the anagram index, grouping it with others that have the same signature.
+ * Works like push_word—later words are inserted right after the group's first word—but
+ * finds the group with a hash lookup and takes its memory from the index's pool. The
+ * word isn't copied, so it must outlive the index. New groups are appended to the
+ * index's list in insertion order; call sort_anagram_groups when the sorted order is needed.
+ * A word with more than 15 of a letter is left out and counted in num_saturated, since
+ * its signature would group it with words that aren't its anagrams.
+ * @param index The index to add to.
+ * @param sig Signature of the word (from word_signature).
+ * @param word The original word to add (e.g., "tea").
+ */
+void index_push_sig(anagramIndex *index, anagramSig sig, char *word) {
+    if (!sig_exact(sig)) {
+        index->num_saturated++;
+        return;
+    }
+    indexSlot *slot = probe(index->slots, index->capacity, sig);
+    node *new_word = pool_alloc(index, sizeof(node));
+    new_word->word = word;
+
+    if (slot->group) {
+        // Signature exists, add word to this group
+        nodePrimary *group = slot->group;
+        new_word->next = group->words->next; // Insert after the first word
+        group->words->next = new_word;
+        group->group_size++;
+        return;
+    }
+
+    // No matching group, create a new one at the end of the list
+    nodePrimary *new_group = pool_alloc(index, sizeof(nodePrimary));
+    new_group->sig = sig;
+    new_group->sorted_key = pool_alloc(index, sig_length(sig) + 1);
+    sig_to_key(sig, new_group->sorted_key);
+    new_group->group_size = 1;
+    new_word->next = NULL;
+    new_group->words = new_word;
+    link_group(index, slot, new_group);
+}
+
+/**
+ * Adds a word to the anagram index given its sorted key (see index_push_sig).
+ * @param index The index to add to.
+ * @param sorted_key Sorted version of the word (e.g., "aet" for "tea").
+ * @param word The original word to add (e.g., "tea").
+ */
+void index_push_word(anagramIndex *index, char *sorted_key, char *word) {
+    index_push_sig(index, word_signature(sorted_key), word);
+}
+
+/**
+ * Compares two groups by key length, then alphabetically (the order print_anagram_groups uses).
+ * @param a Pointer to the first group pointer.
+ * @param b Pointer to the second group pointer.
+ * @return Negative, zero or positive, like strcmp.
+ */
+static int cmp_groups(const void *a, const void *b) {
+    return sig_cmp((*(nodePrimary *const *)a)->sig, (*(nodePrimary *const *)b)->sig);
+}
+
+/**
+ * Relinks the index's groups so the list runs by key length, then alphabetically.
+ * This is the same order push_word maintains, but done once with qsort instead of on
+ * every insert. The hash table is untouched, so lookups keep working afterwards.
+ * @param index The index whose groups should be sorted.
+ * @return Pointer to the first group of the sorted list.
+ */
+nodePrimary *sort_anagram_groups(anagramIndex *index) {
+    int n = index->num_groups;
+    if (n == 0) return NULL;
+    nodePrimary **groups = malloc(n * sizeof(nodePrimary *));
+    if (!groups) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    int i = 0;
+    for (nodePrimary *cur = index->head; cur; cur = cur->next) groups[i++] = cur;
+    qsort(groups, n, sizeof(nodePrimary *), cmp_groups);
+
+    for (i = 0; i < n - 1; i++) groups[i]->next = groups[i + 1];
+    groups[n - 1]->next = NULL;
+    index->head = groups[0];
+    index->tail = groups[n - 1];
+    free(groups);
+    return index->head;
+}
+
+/**
+ * Builds a hash-indexed set of anagram groups from a loaded word list.
+ * Each word's signature is computed in place and the word added to the matching
+ * group; nothing is allocated per word. The index points at the words, so keep the
+ * word list alive until the index is freed. The groups are left in insertion
+ * order; use sort_anagram_groups for the sorted list.
+ * @param words Array of word views (NUL-terminated, as from load_word_list).
+ * @param n Number of words in the array.
+ * @return Pointer to the new index.
+ */
+anagramIndex *make_anagram_index(wordView *words, int n) {
+    anagramIndex *index = create_anagram_index(n / 2);
+    for (int i = 0; i < n; i++)
+        index_push_sig(index, word_signature(words[i].str), words[i].str);
+    return index;
+}
+
+#define NUM_SHARDS 64 // Fixed, so the grouping doesn't depend on the thread count
+
+/*
+ * Shared state for one parallel build. Every phase splits its work statically by
+ * worker id, so workers never write to the same array slot.
+ */
+typedef struct buildJob {
+    wordView *words;          // Input words
+    int n;                    // Number of input words
+    int num_threads;          // Number of workers
+    anagramSig *sigs;         // Signature of each word (phase 1)
+    int *shard_counts;        // Words per (chunk, shard), then scatter cursors (phases 1-2)
+    int *order;               // Word indexes grouped by shard, in input order (phase 2)
+    int shard_start[NUM_SHARDS + 1]; // Where each shard's run starts in order
+    anagramIndex *shards[NUM_SHARDS]; // Per-shard indexes (phase 3)
+} buildJob;
+
+typedef struct buildWorker {
+    buildJob *job;
+    int id;                   // Worker number, 0 to num_threads - 1
+    int phase;                // Which phase to run
+} buildWorker;
+
+/**
+ * Runs one phase of the parallel build for one worker.
+ * Phase 1 computes signatures for the worker's chunk and counts words per shard,
+ * phase 2 scatters the chunk's word indexes into shard order, and phase 3 groups
+ * and sorts every shard assigned to the worker in its own index.
+ * @param arg Pointer to the worker's buildWorker.
+ * @return Always NULL.
+ */
+static void *build_worker(void *arg) {
+    buildWorker *worker = arg;
+    buildJob *job = worker->job;
+    int lo = (long)job->n * worker->id / job->num_threads;
+    int hi = (long)job->n * (worker->id + 1) / job->num_threads;
+    int *counts = &job->shard_counts[worker->id * NUM_SHARDS];
+
+    if (worker->phase == 1) {
+        for (int i = lo; i < hi; i++) {
+            job->sigs[i] = word_signature(job->words[i].str);
+            counts[hash_sig(job->sigs[i]) % NUM_SHARDS]++;
+        }
+    } else if (worker->phase == 2) {
+        for (int i = lo; i < hi; i++)
+            job->order[counts[hash_sig(job->sigs[i]) % NUM_SHARDS]++] = i;
+    } else {
+        for (int s = worker->id; s < NUM_SHARDS; s += job->num_threads) {
+            int size = job->shard_start[s + 1] - job->shard_start[s];
+            anagramIndex *shard = create_anagram_index(size / 2);
+            for (int k = job->shard_start[s]; k < job->shard_start[s + 1]; k++) {
+                int i = job->order[k];
+                index_push_sig(shard, job->sigs[i], job->words[i].str);
+            }
+            sort_anagram_groups(shard); // Sort per shard so the final merge is linear
+            job->shards[s] = shard;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Restores the heap order of an array of sorted group lists, keyed by their heads.
+ * @param heap Min-heap of non-empty lists.
+ * @param size Number of lists in the heap.
+ * @param i Position whose head may now be too large.
+ */
+static void sift_down(nodePrimary **heap, int size, int i) {
+    while (1) {
+        int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && sig_cmp(heap[l]->sig, heap[smallest]->sig) < 0) smallest = l;
+        if (r < size && sig_cmp(heap[r]->sig, heap[smallest]->sig) < 0) smallest = r;
+        if (smallest == i) return;
+        nodePrimary *tmp = heap[i]; heap[i] = heap[smallest]; heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/**
+ * Merges sorted group lists (key length, then alphabetical) into one sorted list,
+ * using a small heap of list heads.
+ * @param lists Array of sorted lists (entries may be NULL); used as the heap.
+ * @param num_lists Number of lists.
+ * @return Head of the merged sorted list.
+ */
+static nodePrimary *merge_sorted_groups(nodePrimary **lists, int num_lists) {
+    int size = 0;
+    for (int i = 0; i < num_lists; i++)
+        if (lists[i]) lists[size++] = lists[i];
+    for (int i = size / 2 - 1; i >= 0; i--) sift_down(lists, size, i);
+
+    nodePrimary head = {0}, *tail = &head;
+    while (size > 0) {
+        tail->next = lists[0];
+        tail = lists[0];
+        lists[0] = lists[0]->next;
+        if (!lists[0]) lists[0] = lists[--size]; // That list is used up
+        sift_down(lists, size, 0);
+    }
+    tail->next = NULL;
+    return head.next;
+}
+
+/**
+ * Starts one worker thread per buildWorker for a phase and waits for all of them.
+ * @param workers Array of workers (already pointing at the job).
+ * @param threads Array to hold the thread handles.
+ * @param num_threads Number of workers.
+ * @param phase Phase to run.
+ */
+static void run_phase(buildWorker *workers, pthread_t *threads, int num_threads, int phase) {
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].phase = phase;
+        if (pthread_create(&threads[t], NULL, build_worker, &workers[t]) != 0) {
+            perror("Failed to start build thread");
+            exit(1);
+        }
+    }
+    for (int t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+}
+
+/**
+ * Builds a hash-indexed set of anagram groups using several threads.
+ * Workers compute signatures over contiguous chunks of the word array, the words are
+ * partitioned by signature hash into a fixed number of shards, and each shard is grouped
+ * on its own. Because shards are filled in input order and the merged groups are
+ * sorted, the result is the same for every thread count and matches make_anagram_index
+ * once sorted (same groups, same word order inside each group).
+ * @param words Array of word views, NUL-terminated (must outlive the index).
+ * @param n Number of words in the array.
+ * @param num_threads Number of worker threads (0 or less means one per online CPU).
+ * @return Pointer to the new index, with its groups already sorted.
+ */
+anagramIndex *make_anagram_index_parallel(wordView *words, int n, int num_threads) {
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+
+    buildJob job = {0};
+    job.words = words;
+    job.n = n;
+    job.num_threads = num_threads;
+    job.sigs = malloc(n * sizeof(anagramSig));
+    job.order = malloc(n * sizeof(int));
+    job.shard_counts = calloc((size_t)num_threads * NUM_SHARDS, sizeof(int));
+    buildWorker *workers = malloc(num_threads * sizeof(buildWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if ((n > 0 && (!job.sigs || !job.order)) || !job.shard_counts || !workers || !threads) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].job = &job;
+        workers[t].id = t;
+    }
+
+    run_phase(workers, threads, num_threads, 1);
+
+    // Turn per-chunk counts into scatter cursors: shard by shard, chunk by chunk
+    int pos = 0;
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        job.shard_start[s] = pos;
+        for (int t = 0; t < num_threads; t++) {
+            int count = job.shard_counts[t * NUM_SHARDS + s];
+            job.shard_counts[t * NUM_SHARDS + s] = pos;
+            pos += count;
+        }
+    }
+    job.shard_start[NUM_SHARDS] = pos;
+
+    run_phase(workers, threads, num_threads, 2);
+    run_phase(workers, threads, num_threads, 3);
+
+    // Merge the sorted shard lists into one table; the new index takes over their pools
+    nodePrimary *lists[NUM_SHARDS];
+    for (int s = 0; s < NUM_SHARDS; s++) lists[s] = job.shards[s]->head;
+    anagramIndex *index = create_anagram_index(n / 2);
+    for (nodePrimary *cur = merge_sorted_groups(lists, NUM_SHARDS), *next; cur; cur = next) {
+        next = cur->next;
+        link_group(index, probe(index->slots, index->capacity, cur->sig), cur);
+    }
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        anagramIndex *shard = job.shards[s];
+        poolBlock *last = shard->pool;
+        while (last && last->next) last = last->next;
+        if (last) {
+            last->next = index->pool;
+            index->pool = shard->pool;
+            shard->pool = NULL;
+        }
+        index->num_saturated += shard->num_saturated;
+        free_anagram_index(shard);
+    }
+
+    free(threads);
+    free(workers);
+    free(job.shard_counts);
+    free(job.order);
+    free(job.sigs);
+    return index;
 }
\ No newline at end of file
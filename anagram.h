@@ -1,18 +1,95 @@
 #ifndef ANAGRAM_H
 #define ANAGRAM_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "utils.h"
+
 typedef struct node {
     char *word;         // Word in the node
     struct node *next;  // Next word node
 } node;
 
+/*
+ * Fixed-width anagram signature: the letter counts of a word packed four bits per
+ * letter. lo holds the letter count in its top 12 bits, then 'a' (bits 48-51) down
+ * to 'm' (bits 0-3); hi holds 'n' (bits 48-51) down to 'z' (bits 0-3). Counts
+ * saturate at 15, which no word in the bundled lists comes near; a signature that
+ * saturated no longer matches its letters, and sig_exact tells (its counts fall
+ * short of its length). Callers taking arbitrary input should check it.
+ */
+typedef struct anagramSig {
+    uint64_t lo;
+    uint64_t hi;
+} anagramSig;
+
 typedef struct nodePrimary {
     char *sorted_key;         // Sorted key for the anagram group
     struct node *words;       // List of words in the group
     int group_size;           // Number of words in the group
     struct nodePrimary *next; // Next anagram group
+    anagramSig sig;           // Letter-count signature (set by anagramIndex groups)
 } nodePrimary;
 
+typedef struct indexSlot {
+    anagramSig sig;           // Signature of the group in this slot
+    nodePrimary *group;       // Group stored in this slot (NULL if empty)
+} indexSlot;
+
+typedef struct poolBlock poolBlock;
+
+typedef struct anagramIndex {
+    indexSlot *slots;         // Open-addressing hash table of groups, keyed by signature
+    int capacity;             // Number of slots (always a power of two)
+    int num_groups;           // Number of groups stored in the table
+    int num_saturated;        // Words left out for having more than 15 of a letter
+    nodePrimary *head;        // Groups in insertion order (sorted by sort_anagram_groups)
+    nodePrimary *tail;        // Last group in the list
+    poolBlock *pool;          // Blocks holding the groups, word nodes and keys
+} anagramIndex;
+
+// Signature comparisons sit on every hash probe and sort step, so they are inlined.
+static inline int sig_equal(anagramSig a, anagramSig b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+// Same order as comparing sorted keys by length, then alphabetically: for equal
+// lengths, the key with more of the earliest differing letter sorts first.
+static inline int sig_cmp(anagramSig a, anagramSig b) {
+    if ((a.lo >> 52) != (b.lo >> 52)) return (a.lo >> 52) < (b.lo >> 52) ? -1 : 1;
+    if (a.lo != b.lo) return a.lo > b.lo ? -1 : 1;
+    if (a.hi != b.hi) return a.hi > b.hi ? -1 : 1;
+    return 0;
+}
+
+static inline unsigned int hash_sig(anagramSig sig) {
+    uint64_t h = sig.lo * 0x9E3779B97F4A7C15ull ^ sig.hi;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    return (unsigned int)(h ^ (h >> 32));
+}
+
+// Whether a needs no more of any letter than b has (a's word can be spelled from b's
+// letters). The 4-bit counts are spread into bytes, even and odd letters in turn, so
+// each gets a spare top bit: 0x80 + have - need keeps it exactly when have >= need.
+static inline int sig_fits(anagramSig a, anagramSig b) {
+    const uint64_t low = 0x0F0F0F0F0F0F0F0Full, high = 0x8080808080808080ull;
+    const uint64_t counts = 0x000FFFFFFFFFFFFFull; // Drops the length bits of lo
+    uint64_t need[2] = {a.lo & counts, a.hi}, have[2] = {b.lo & counts, b.hi};
+    for (int h = 0; h < 2; h++) {
+        if (((((have[h] & low) | high) - (need[h] & low)) & high) != high) return 0;
+        if (((((have[h] >> 4 & low) | high) - (need[h] >> 4 & low)) & high) != high) return 0;
+    }
+    return 1;
+}
+
+// The letters left in b after spelling a from them (only valid when sig_fits(a, b)).
+// No count can borrow, so plain subtraction works, length field included.
+static inline anagramSig sig_subtract(anagramSig b, anagramSig a) {
+    anagramSig rest = {b.lo - a.lo, b.hi - a.hi};
+    return rest;
+}
+
 void free_anagram_list(nodePrimary *head);
 nodePrimary *create_node_primary(char *word);
 void push_word(nodePrimary **head, char *sorted_key, char *word);
@@ -26,5 +103,19 @@ int size_sec_list(node *head);
 void get_longest_pair(nodePrimary *head, char **word1, char **word2);
 void process(nodePrimary *head, int **x, double **H, int *n);
 nodePrimary *make_anagram_list(char **words, int n);
+anagramSig word_signature(const char *word);
+int sig_length(anagramSig sig);
+int sig_exact(anagramSig sig);
+int sig_to_key(anagramSig sig, char *buffer);
+uint32_t sig_letter_mask(anagramSig sig);
+anagramIndex *create_anagram_index(int expected_groups);
+void free_anagram_index(anagramIndex *index);
+nodePrimary *index_find_group(anagramIndex *index, const char *sorted_key);
+nodePrimary *index_find_sig(anagramIndex *index, anagramSig sig);
+void index_push_word(anagramIndex *index, char *sorted_key, char *word);
+void index_push_sig(anagramIndex *index, anagramSig sig, char *word);
+nodePrimary *sort_anagram_groups(anagramIndex *index);
+anagramIndex *make_anagram_index(wordView *words, int n);
+anagramIndex *make_anagram_index_parallel(wordView *words, int n, int num_threads);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,343 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "anagram.h"
+#include "anaindex.h"
+
+/**
+ * Rounds a byte count up to the next multiple of 8 so every section stays aligned.
+ * @param n Byte count.
+ * @return n rounded up to a multiple of 8.
+ */
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+/**
+ * Lays out an anagram index as a single contiguous image in the on-disk format.
+ * Sorts the groups first (length, then alphabetical), then writes the header, group
+ * records, word offsets, an open-addressing hash table over the signatures, the
+ * word strings and the sub-anagram search tables (letter masks and length buckets).
+ * @param index The in-memory index to serialize (its groups get sorted).
+ * @param size Pointer to store the size of the image in bytes.
+ * @return Heap-allocated image, or NULL if allocation fails.
+ */
+char *serialize_anagram_index(anagramIndex *index, size_t *size) {
+    nodePrimary *head = sort_anagram_groups(index);
+
+    // First pass: count words and string bytes so the image can be allocated once
+    uint32_t num_groups = 0, num_words = 0, max_length = 0;
+    size_t strings_size = 0;
+    for (nodePrimary *cur = head; cur; cur = cur->next) {
+        num_groups++;
+        max_length = sig_length(cur->sig); // Sorted by length, so the last one is longest
+        for (node *w = cur->words; w; w = w->next) {
+            num_words++;
+            strings_size += strlen(w->word) + 1;
+        }
+    }
+    uint32_t table_size = 16;
+    while (table_size < 2 * num_groups) table_size *= 2; // Keep load under 1/2
+
+    size_t groups_offset = align8(sizeof(anaIndexHeader));
+    size_t words_offset = align8(groups_offset + num_groups * sizeof(anaGroup));
+    size_t table_offset = align8(words_offset + num_words * sizeof(uint32_t));
+    size_t strings_offset = align8(table_offset + table_size * sizeof(uint32_t));
+    size_t masks_offset = align8(strings_offset + strings_size);
+    size_t lengths_offset = align8(masks_offset + num_groups * sizeof(uint32_t));
+    size_t total = align8(lengths_offset + (max_length + 2) * sizeof(uint32_t));
+    if (total > UINT32_MAX) {
+        fprintf(stderr, "Error: Anagram index too large (%zu bytes).\n", total);
+        return NULL;
+    }
+
+    char *image = calloc(1, total);
+    if (!image) {
+        perror("Memory allocation failed for index image");
+        return NULL;
+    }
+    anaIndexHeader *header = (anaIndexHeader *)image;
+    memcpy(header->magic, ANAINDEX_MAGIC, sizeof(header->magic));
+    header->version = ANAINDEX_VERSION;
+    header->num_groups = num_groups;
+    header->num_words = num_words;
+    header->table_size = table_size;
+    header->groups_offset = groups_offset;
+    header->words_offset = words_offset;
+    header->table_offset = table_offset;
+    header->strings_offset = strings_offset;
+    header->strings_size = strings_size;
+    header->masks_offset = masks_offset;
+    header->lengths_offset = lengths_offset;
+    header->max_length = max_length;
+
+    anaGroup *groups = (anaGroup *)(image + groups_offset);
+    uint32_t *words = (uint32_t *)(image + words_offset);
+    uint32_t *table = (uint32_t *)(image + table_offset);
+    char *strings = image + strings_offset;
+    uint32_t *masks = (uint32_t *)(image + masks_offset);
+    uint32_t *lengths = (uint32_t *)(image + lengths_offset);
+
+    // Second pass: fill in groups, words, strings and the search tables
+    uint32_t g = 0, w = 0, pos = 0, length = 0;
+    for (nodePrimary *cur = head; cur; cur = cur->next, g++) {
+        groups[g].sig = cur->sig;
+        masks[g] = sig_letter_mask(cur->sig);
+        while (length <= (uint32_t)sig_length(cur->sig)) lengths[length++] = g; // Lengths start here
+        groups[g].first_word = w;
+        for (node *word = cur->words; word; word = word->next) {
+            size_t len = strlen(word->word);
+            words[w++] = pos;
+            memcpy(strings + pos, word->word, len + 1);
+            pos += len + 1;
+        }
+        groups[g].word_count = w - groups[g].first_word;
+
+        // Linear probing, same as the in-memory index
+        uint32_t mask = table_size - 1, slot = hash_sig(cur->sig) & mask;
+        while (table[slot]) slot = (slot + 1) & mask;
+        table[slot] = g + 1;
+    }
+    while (length <= max_length + 1) lengths[length++] = num_groups;
+
+    *size = total;
+    return image;
+}
+
+/**
+ * Writes an anagram index to disk in the on-disk format.
+ * @param index The in-memory index to save.
+ * @param file_path Path of the index file to create.
+ * @return 0 on success, -1 on failure.
+ */
+int save_anagram_index(anagramIndex *index, const char *file_path) {
+    size_t size;
+    char *image = serialize_anagram_index(index, &size);
+    if (!image) return -1;
+
+    FILE *fptr = fopen(file_path, "wb");
+    if (!fptr) {
+        perror("Error opening index file");
+        free(image);
+        return -1;
+    }
+    int ok = fwrite(image, 1, size, fptr) == size;
+    if (fclose(fptr) != 0) ok = 0;
+    free(image);
+    if (!ok) {
+        perror("Error writing index file");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Checks whether a file starts with the anagram index magic bytes.
+ * Lets tools accept either a word list or a prebuilt index on the command line.
+ * @param file_path Path to the file to check.
+ * @return 1 if the file is an anagram index, 0 otherwise.
+ */
+int is_anagram_index_file(const char *file_path) {
+    char magic[8];
+    FILE *fptr = fopen(file_path, "rb");
+    if (!fptr) return 0;
+    int is_index = fread(magic, 1, sizeof(magic), fptr) == sizeof(magic) &&
+                   memcmp(magic, ANAINDEX_MAGIC, sizeof(magic)) == 0;
+    fclose(fptr);
+    return is_index;
+}
+
+/**
+ * Checks the contents of an index image whose sections lie within it, so that queries
+ * can trust every offset and index they read without checking it again: table entries
+ * name real groups and leave at least one slot empty (so lookups end), group word
+ * ranges lie within the words array, word offsets lie within the string pool, which
+ * ends in a NUL, and the length buckets name real groups.
+ * @param image Start of the image.
+ * @param header The image's header (sections already checked to fit).
+ * @return 1 if the contents are consistent, 0 if not.
+ */
+static int contents_valid(const char *image, const anaIndexHeader *header) {
+    const uint32_t *table = (const uint32_t *)(image + header->table_offset);
+    int empty_slots = 0;
+    for (uint32_t slot = 0; slot < header->table_size; slot++) {
+        if (table[slot] > header->num_groups) return 0;
+        empty_slots += table[slot] == 0;
+    }
+    if (empty_slots == 0) return 0;
+
+    const anaGroup *groups = (const anaGroup *)(image + header->groups_offset);
+    for (uint32_t g = 0; g < header->num_groups; g++) {
+        if (groups[g].first_word > header->num_words ||
+            groups[g].word_count > header->num_words - groups[g].first_word) return 0;
+    }
+
+    const uint32_t *words = (const uint32_t *)(image + header->words_offset);
+    for (uint32_t w = 0; w < header->num_words; w++) {
+        if (words[w] >= header->strings_size) return 0;
+    }
+    if (header->strings_size > 0 && image[header->strings_offset + header->strings_size - 1] != '\0') return 0;
+    if (header->strings_size == 0 && header->num_words > 0) return 0;
+
+    const uint32_t *lengths = (const uint32_t *)(image + header->lengths_offset);
+    for (uint32_t len = 0; len < header->max_length + 2; len++) {
+        if (lengths[len] > header->num_groups) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Wraps an index image and checks that its header, sections and contents are consistent.
+ * Takes ownership of the image: it is freed (or unmapped) by close_anagram_index,
+ * or straight away if the image turns out to be invalid.
+ * @param image Start of the image.
+ * @param size Size of the image in bytes.
+ * @param mapped 1 if the image is an mmap'd file, 0 if it is malloc'd.
+ * @return Pointer to the index, or NULL if the image is not a valid index.
+ */
+static anaIndex *wrap_image(char *image, size_t size, int mapped) {
+    const anaIndexHeader *header = (const anaIndexHeader *)image;
+    int valid = size >= sizeof(anaIndexHeader) &&
+                memcmp(header->magic, ANAINDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == ANAINDEX_VERSION &&
+                header->groups_offset + (size_t)header->num_groups * sizeof(anaGroup) <= size &&
+                header->words_offset + (size_t)header->num_words * sizeof(uint32_t) <= size &&
+                header->table_offset + (size_t)header->table_size * sizeof(uint32_t) <= size &&
+                header->strings_offset + (size_t)header->strings_size <= size &&
+                header->masks_offset + (size_t)header->num_groups * sizeof(uint32_t) <= size &&
+                header->lengths_offset + ((size_t)header->max_length + 2) * sizeof(uint32_t) <= size &&
+                header->table_size > 0 && (header->table_size & (header->table_size - 1)) == 0 &&
+                contents_valid(image, header);
+    anaIndex *index = valid ? malloc(sizeof(anaIndex)) : NULL;
+    if (!index) {
+        if (valid) perror("Memory allocation failed");
+        else fprintf(stderr, "Error: Not a valid anagram index (version %d expected).\n", ANAINDEX_VERSION);
+        if (mapped) munmap(image, size); else free(image);
+        return NULL;
+    }
+    index->base = image;
+    index->size = size;
+    index->mapped = mapped;
+    index->header = header;
+    index->groups = (const anaGroup *)(image + header->groups_offset);
+    index->words = (const uint32_t *)(image + header->words_offset);
+    index->table = (const uint32_t *)(image + header->table_offset);
+    index->strings = image + header->strings_offset;
+    index->masks = (const uint32_t *)(image + header->masks_offset);
+    index->lengths = (const uint32_t *)(image + header->lengths_offset);
+    return index;
+}
+
+/**
+ * Maps an anagram index file into memory, read-only and shared.
+ * Nothing is parsed or copied: queries read the mapped pages directly, so every process
+ * using the same file shares one page-cache copy of it.
+ * @param file_path Path to the index file.
+ * @return Pointer to the index, or NULL if the file can't be mapped or isn't valid.
+ */
+anaIndex *open_anagram_index(const char *file_path) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening index file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Error: Could not read index file %s\n", file_path);
+        close(fd);
+        return NULL;
+    }
+    void *image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (image == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    return wrap_image(image, st.st_size, 1);
+}
+
+/**
+ * Wraps an in-memory image (from serialize_anagram_index) as a queryable index.
+ * This lets a freshly built word list be queried through exactly the same code as a
+ * mapped index file.
+ * @param image Heap-allocated image; ownership passes to the index.
+ * @param size Size of the image in bytes.
+ * @return Pointer to the index, or NULL if the image isn't valid.
+ */
+anaIndex *anagram_index_from_image(char *image, size_t size) {
+    return wrap_image(image, size, 0);
+}
+
+/**
+ * Releases an index and its image (unmapping or freeing it as appropriate).
+ * @param index The index to close.
+ */
+void close_anagram_index(anaIndex *index) {
+    if (!index) return;
+    if (index->mapped) munmap((void *)index->base, index->size);
+    else free((void *)index->base);
+    free(index);
+}
+
+/**
+ * Looks up the anagram group for a signature straight from the index image.
+ * @param index The index to search.
+ * @param sig The signature to look for (from word_signature).
+ * @return Pointer to the matching group record, or NULL if there is none.
+ */
+const anaGroup *ana_find_group(const anaIndex *index, anagramSig sig) {
+    uint32_t mask = index->header->table_size - 1;
+    for (uint32_t slot = hash_sig(sig) & mask; index->table[slot]; slot = (slot + 1) & mask) {
+        const anaGroup *group = &index->groups[index->table[slot] - 1];
+        if (sig_equal(group->sig, sig)) return group;
+    }
+    return NULL;
+}
+
+/**
+ * Returns the i-th word of a group.
+ * @param index The index the group belongs to.
+ * @param group The group record.
+ * @param i Position of the word within the group (0 to word_count - 1).
+ * @return Pointer to the NUL-terminated word inside the image.
+ */
+const char *ana_word(const anaIndex *index, const anaGroup *group, int i) {
+    return index->strings + index->words[group->first_word + i];
+}
+
+/**
+ * Finds every group whose words can be spelled from a set of letters (sub-anagrams),
+ * e.g., "eat", "tea", "ate" and "at" from the letters of "tease".
+ * Only the length buckets from min_length up to the number of letters are scanned,
+ * and a group using any letter the set lacks is dropped with one AND of the masks,
+ * so per-letter counts are only compared for the few groups that get past that.
+ * @param index The index to search.
+ * @param letters Signature of the available letters (from word_signature).
+ * @param min_length Shortest key length to report (1 for everything).
+ * @param groups Array to receive the indices of matching groups, shortest first.
+ * @param max_groups Capacity of groups; matches beyond it are counted but not stored.
+ * @return Number of matching groups.
+ */
+int ana_sub_anagrams(const anaIndex *index, anagramSig letters, int min_length,
+                     uint32_t *groups, int max_groups) {
+    uint32_t max_length = index->header->max_length;
+    uint32_t shortest = min_length > 0 ? (uint32_t)min_length : 1;
+    uint32_t longest = (uint32_t)sig_length(letters);
+    if (longest > max_length) longest = max_length;
+    if (shortest > longest) return 0;
+
+    uint32_t missing = ~sig_letter_mask(letters) & 0x3FFFFFF; // Letters we can't use
+    int found = 0;
+    for (uint32_t g = index->lengths[shortest]; g < index->lengths[longest + 1]; g++) {
+        if (index->masks[g] & missing) continue;
+        if (!sig_fits(index->groups[g].sig, letters)) continue;
+        if (found < max_groups) groups[found] = g;
+        found++;
+    }
+    return found;
+}
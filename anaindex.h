@@ -0,0 +1,73 @@
+#ifndef ANAINDEX_H
+#define ANAINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "anagram.h"
+
+#define ANAINDEX_MAGIC "ANAIDX\0\0"
+#define ANAINDEX_VERSION 3
+
+/*
+ * On-disk anagram index. Everything lives in one contiguous image:
+ *
+ *   header | groups[num_groups] | words[num_words] | table[table_size] | strings
+ *          | masks[num_groups] | lengths[max_length + 2]
+ *
+ * Offsets are byte offsets from the start of the image, so the file can be mmap'd
+ * and read in place. Groups are keyed by their anagramSig and stored in
+ * print_anagram_groups order (key length, then alphabetical); each group's words are
+ * a contiguous run of the words array. Sorted keys aren't stored: sig_to_key
+ * rebuilds one from the signature when it has to be shown.
+ *
+ * For sub-anagram search, masks[g] holds the letters group g uses (sig_letter_mask),
+ * kept apart from the group records so a scan reads nothing else, and since groups
+ * are sorted by length, lengths[L] is the first group with at least L letters.
+ */
+typedef struct anaIndexHeader {
+    char magic[8];             // ANAINDEX_MAGIC
+    uint32_t version;          // ANAINDEX_VERSION
+    uint32_t num_groups;       // Number of anagram groups
+    uint32_t num_words;        // Number of words across all groups
+    uint32_t table_size;       // Number of hash slots (a power of two)
+    uint32_t groups_offset;    // Offset of the group records
+    uint32_t words_offset;     // Offset of the word offset array
+    uint32_t table_offset;     // Offset of the hash table
+    uint32_t strings_offset;   // Offset of the NUL-terminated words
+    uint32_t strings_size;     // Size of the string pool in bytes
+    uint32_t masks_offset;     // Offset of the per-group letter masks
+    uint32_t lengths_offset;   // Offset of the length buckets
+    uint32_t max_length;       // Letters in the longest group's key
+} anaIndexHeader;
+
+typedef struct anaGroup {
+    anagramSig sig;            // Letter-count signature shared by the group's words
+    uint32_t first_word;       // Index of the group's first word in the words array
+    uint32_t word_count;       // Number of words in the group
+} anaGroup;
+
+typedef struct anaIndex {
+    const char *base;          // Start of the image (mapped file or heap buffer)
+    size_t size;               // Size of the image in bytes
+    int mapped;                // 1 if base is an mmap'd file, 0 if it is malloc'd
+    const anaIndexHeader *header;
+    const anaGroup *groups;
+    const uint32_t *words;     // String-pool offsets of the words
+    const uint32_t *table;     // Group index + 1 per slot, 0 for an empty slot
+    const char *strings;       // String pool
+    const uint32_t *masks;     // Letter-presence mask per group
+    const uint32_t *lengths;   // First group of each key length, 0 to max_length + 1
+} anaIndex;
+
+char *serialize_anagram_index(anagramIndex *index, size_t *size);
+int save_anagram_index(anagramIndex *index, const char *file_path);
+int is_anagram_index_file(const char *file_path);
+anaIndex *open_anagram_index(const char *file_path);
+anaIndex *anagram_index_from_image(char *image, size_t size);
+void close_anagram_index(anaIndex *index);
+const anaGroup *ana_find_group(const anaIndex *index, anagramSig sig);
+const char *ana_word(const anaIndex *index, const anaGroup *group, int i);
+int ana_sub_anagrams(const anaIndex *index, anagramSig letters, int min_length,
+                     uint32_t *groups, int max_groups);
+
+#endif
@@ -1,61 +1,394 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <strings.h>  
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "utils.h"    
 #include "anagram.h"
+#include "anaindex.h"
+#include "phrase.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 20) // Bytes of stdout buffering in batch mode
+
+// What a query asks for
+enum {
+    QUERY_ANAGRAMS,     // Words with exactly the query's letters
+    QUERY_SUB_ANAGRAMS, // Words spelled from some of the query's letters
+    QUERY_PHRASES       // Phrases using exactly the query's letters
+};
+
+/**
+ * Loads the anagram index to query, from either a prebuilt index file or a word list.
+ * Index files (made by anabuild) are mmap'd and used as-is, so startup costs nothing.
+ * A plain word list is read and grouped as before, then laid out in the same image
+ * format in memory so both cases share one query path.
+ * @param file_path Path to an index file or a word list (one word per line).
+ * @return Pointer to the index, or NULL if loading fails.
+ */
+static anaIndex *load_index(const char *file_path) {
+    if (is_anagram_index_file(file_path)) return open_anagram_index(file_path);
+
+    // Load all the words from the file in one read
+    wordList *word_list = load_word_list(file_path);
+    if (!word_list) {
+        fprintf(stderr, "Failed to read words from file\n"); 
+        return NULL;
+    }
+
+    // Group words with the same letters, then flatten the groups into an image
+    anagramIndex *anagram_index = make_anagram_index(word_list->words, word_list->count);
+    if (anagram_index->num_saturated > 0)
+        fprintf(stderr, "Warning: left out %d words with more than 15 of a letter\n", anagram_index->num_saturated);
+    size_t size;
+    char *image = serialize_anagram_index(anagram_index, &size);
+    free_anagram_index(anagram_index);
+    free_word_list(word_list);
+    if (!image) {
+        fprintf(stderr, "Failed to create anagram index\n");  
+        return NULL;
+    }
+    return anagram_index_from_image(image, size);
+}
+
+/**
+ * Returns the current monotonic time in seconds, for timing queries.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Growable byte buffer each batch worker formats its results into
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} outBuffer;
 
 /**
- * Searches the anagram list for a group matching a given sorted key.
- * This function walks through the list of anagram groups and checks each one’s sorted key
- * (e.g., "aet" for "eat" or "tea") against the provided key. If found, it returns that group.
- * @param list Pointer to the head of the anagram list (start of the chain of groups).
- * @param key The sorted key to look for (e.g., "aet").
- * @return Pointer to the matching nodePrimary if found, or NULL if no match exists.
+ * Appends bytes to an output buffer, doubling it when full.
+ * @param out Buffer to append to.
+ * @param bytes Bytes to append.
+ * @param n Number of bytes.
+ * @return 0 on success, -1 if memory allocation fails.
  */
-nodePrimary *find_group(nodePrimary *list, char *key) {
-    nodePrimary *current = list;  // Start at the head of the list
-    while (current != NULL) {     // Keep going until we reach the end
-        if (strcmp(current->sorted_key, key) == 0) {  // Compare sorted keys
-            return current;  // Match found, return this group
+static int out_append(outBuffer *out, const char *bytes, size_t n) {
+    if (out->len + n > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity : 4096;
+        while (capacity < out->len + n) capacity *= 2;
+        char *grown = realloc(out->data, capacity);
+        if (!grown) {
+            perror("Memory allocation failed");
+            return -1;
         }
-        current = current->next;  // Move to the next group
+        out->data = grown;
+        out->capacity = capacity;
     }
-    return NULL;  // No match found after checking all groups
+    memcpy(out->data + out->len, bytes, n);
+    out->len += n;
+    return 0;
 }
 
-int main() {
-    const char *filename = "words2.txt";  // File containing the list of words
+// One batch thread's share of the queries, and what it produced
+typedef struct {
+    const anaIndex *index;
+    const wordView *queries; // This thread's contiguous run of queries
+    int count;
+    int mode;                // QUERY_ANAGRAMS, QUERY_SUB_ANAGRAMS or QUERY_PHRASES
+    uint32_t *matches;       // Scratch space for sub-anagram group indices
+    outBuffer out;           // Formatted results, written out in query order afterwards
+    double *latencies;       // Seconds spent on each query
+    int failed;
+} batchWorker;
 
-    // Figure out how many words (lines) are in the file
-    int num_words = get_file_size(filename);
-    if (num_words == -1) {
-        fprintf(stderr, "Failed to get file size\n"); 
-        return 1;
-    } else if (num_words == 0) {
-        fprintf(stderr, "File is empty\n"); 
+/**
+ * Formats the answer to one batch phrase query: the query, the number of phrases,
+ * then each phrase (words separated by spaces, alternatives by '/'), tab-separated.
+ * @param w The worker (index and output buffer).
+ * @param query The phrase to rearrange.
+ * @param len Length of the query.
+ * @return 0 on success, -1 if memory allocation fails.
+ */
+static int answer_phrase_query(batchWorker *w, const char *query, int len) {
+    phraseOptions options;
+    default_phrase_options(&options);
+    phraseResults *results = solve_phrase(w->index, query, &options);
+    if (!results) return -1;
+    if (results->saturated) fprintf(stderr, "'%.*s' has more than 15 of a letter; not searched\n", len, query);
+
+    char count[16];
+    int count_len = snprintf(count, sizeof(count), "\t%d", results->count);
+    int status = out_append(&w->out, query, len) || out_append(&w->out, count, count_len) ? -1 : 0;
+    for (int r = 0; r < results->count && status == 0; r++) {
+        status = out_append(&w->out, "\t", 1);
+        for (int p = results->starts[r]; p < results->starts[r + 1] && status == 0; p++) {
+            const anaGroup *group = &w->index->groups[results->groups[p]];
+            if (p > results->starts[r]) status = out_append(&w->out, " ", 1);
+            for (uint32_t i = 0; i < group->word_count && status == 0; i++) {
+                const char *word = ana_word(w->index, group, i);
+                if (i > 0) status = out_append(&w->out, "/", 1);
+                if (status == 0) status = out_append(&w->out, word, strlen(word));
+            }
+        }
+    }
+    if (status == 0) status = out_append(&w->out, "\n", 1);
+    free_phrase_results(results);
+    return status;
+}
+
+/**
+ * Formats the answer to one batch query as a line: the query, the number of words
+ * (or phrases) found, then the words themselves, all tab-separated.
+ * Exact queries leave out the query word itself, as in interactive mode; sub-anagram
+ * queries list every group that fits, shortest first.
+ * @param w The worker (index, mode and output buffer).
+ * @param query The query word.
+ * @param len Length of the query.
+ * @return 0 on success, -1 if memory allocation fails.
+ */
+static int answer_query(batchWorker *w, const char *query, int len) {
+    const anaIndex *index = w->index;
+    if (w->mode == QUERY_PHRASES) return answer_phrase_query(w, query, len);
+    if (!sig_exact(word_signature(query))) {
+        fprintf(stderr, "'%.*s' has more than 15 of a letter; not searched\n", len, query);
+        return out_append(&w->out, query, len) || out_append(&w->out, "\t0\n", 3) ? -1 : 0;
+    }
+
+    const anaGroup *exact = NULL;
+    int num_groups = 0;
+    if (w->mode == QUERY_SUB_ANAGRAMS) {
+        num_groups = ana_sub_anagrams(index, word_signature(query), 1, w->matches,
+                                      index->header->num_groups);
+    } else {
+        exact = ana_find_group(index, word_signature(query));
+        num_groups = exact != NULL;
+    }
+
+    // Count the words first so the count can lead the line
+    int found = 0;
+    for (int m = 0; m < num_groups; m++) {
+        const anaGroup *group = exact ? exact : &index->groups[w->matches[m]];
+        for (uint32_t i = 0; i < group->word_count; i++) {
+            if (exact && strcasecmp(ana_word(index, group, i), query) == 0) continue;
+            found++;
+        }
+    }
+    char count[16];
+    int count_len = snprintf(count, sizeof(count), "\t%d", found);
+    if (out_append(&w->out, query, len) || out_append(&w->out, count, count_len)) return -1;
+    for (int m = 0; m < num_groups; m++) {
+        const anaGroup *group = exact ? exact : &index->groups[w->matches[m]];
+        for (uint32_t i = 0; i < group->word_count; i++) {
+            const char *word = ana_word(index, group, i);
+            if (exact && strcasecmp(word, query) == 0) continue;
+            if (out_append(&w->out, "\t", 1) || out_append(&w->out, word, strlen(word))) return -1;
+        }
+    }
+    return out_append(&w->out, "\n", 1);
+}
+
+/**
+ * Answers one thread's queries, formatting a line per query into its own buffer.
+ * @param arg Pointer to the thread's batchWorker.
+ * @return NULL.
+ */
+static void *batch_worker(void *arg) {
+    batchWorker *w = arg;
+    for (int q = 0; q < w->count; q++) {
+        double t0 = now();
+        if (answer_query(w, w->queries[q].str, w->queries[q].len)) {
+            w->failed = 1;
+            return NULL;
+        }
+        w->latencies[q] = now() - t0;
+    }
+    return NULL;
+}
+
+/**
+ * Compares two doubles for qsort, in ascending order.
+ */
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Answers a whole file of queries without prompts (batch mode).
+ * The queries are split into contiguous runs, one per thread, all reading the same
+ * index; each thread formats into its own buffer and the buffers are written out
+ * in order through one large stdout buffer, so the output matches a 1-thread run.
+ * Queries per second and p50/p99 lookup latency are reported on stderr.
+ * @param index Index to query (shared read-only by all threads).
+ * @param query_path File of queries, one per line, or "-" for standard input.
+ * @param num_threads Threads to use (0 means one per CPU).
+ * @param mode QUERY_ANAGRAMS, QUERY_SUB_ANAGRAMS or QUERY_PHRASES.
+ * @return 0 on success, 1 on failure.
+ */
+static int run_batch(const anaIndex *index, const char *query_path, int num_threads, int mode) {
+    wordList *queries = strcmp(query_path, "-") == 0 ? read_word_list(stdin)
+                                                     : load_word_list(query_path);
+    if (!queries) {
+        fprintf(stderr, "Failed to read queries\n");
         return 1;
     }
+    int n = queries->count;
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > n) num_threads = n > 0 ? n : 1;
 
-    // Load all the words from the file into an array
-    char **word_list = read_txt_file(filename, num_words);
-    if (!word_list) {
-        fprintf(stderr, "Failed to read words from file\n"); 
+    double *latencies = malloc((n > 0 ? n : 1) * sizeof(double));
+    batchWorker *workers = calloc(num_threads, sizeof(batchWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!latencies || !workers || !threads) {
+        perror("Memory allocation failed");
+        free(latencies);
+        free(workers);
+        free(threads);
+        free_word_list(queries);
         return 1;
     }
 
-    // Build the anagram list by grouping words with the same sorted letters
-    nodePrimary *anagram_list = make_anagram_list(word_list, num_words);
-    if (!anagram_list) {
-        fprintf(stderr, "Failed to create anagram list\n");  
-        // Clean up the word array before exiting
-        for (int i = 0; i < num_words; i++) {
-            free(word_list[i]);  
+    double start = now();
+    int started = 0;
+    for (int t = 0; t < num_threads; t++) {
+        int lo = (int)((long long)n * t / num_threads);
+        int hi = (int)((long long)n * (t + 1) / num_threads);
+        workers[t].index = index;
+        workers[t].queries = queries->words + lo;
+        workers[t].count = hi - lo;
+        workers[t].latencies = latencies + lo;
+        workers[t].mode = mode;
+        if (mode == QUERY_SUB_ANAGRAMS && !(workers[t].matches = malloc((index->header->num_groups + 1) * sizeof(uint32_t)))) {
+            perror("Memory allocation failed");
+            workers[t].failed = 1;
+            break;
         }
-        free(word_list);  
+        if (t > 0 && pthread_create(&threads[t], NULL, batch_worker, &workers[t]) != 0) {
+            perror("Failed to start thread");
+            workers[t].failed = 1;
+            break;
+        }
+        started = t + 1;
+    }
+    if (!workers[0].failed) batch_worker(&workers[0]);  // The main thread takes the first run itself
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+
+    // Write every thread's results in query order through one big buffer
+    int status = 0;
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    for (int t = 0; t < num_threads; t++) {
+        if (workers[t].failed) status = 1;
+        else fwrite(workers[t].out.data, 1, workers[t].out.len, stdout);
+        free(workers[t].out.data);
+        free(workers[t].matches);
+    }
+    fflush(stdout);
+    double elapsed = now() - start;
+
+    if (status == 0 && n > 0) {
+        // Nearest-rank percentiles over the per-query times
+        qsort(latencies, n, sizeof(double), compare_doubles);
+        double p50 = latencies[(n - 1) / 2], p99 = latencies[(int)((n - 1) * 0.99)];
+        fprintf(stderr, "%d queries, %d threads, %.3f s: %.0f queries/s, p50 %.2f us, p99 %.2f us\n",
+                n, num_threads, elapsed, n / elapsed, p50 * 1e6, p99 * 1e6);
+    }
+
+    free(latencies);
+    free(workers);
+    free(threads);
+    free_word_list(queries);
+    return status;
+}
+
+/**
+ * Prints every word that can be spelled from the letters of the input, shortest first
+ * (interactive -s mode).
+ * @param index Index to search.
+ * @param input The letters to spell from.
+ */
+static void print_sub_anagrams(const anaIndex *index, const char *input) {
+    printf("Words from '%s': ", input);
+    uint32_t *matches = malloc((index->header->num_groups + 1) * sizeof(uint32_t));
+    if (!matches) {
+        perror("Memory allocation failed");
+        return;
+    }
+    int num_groups = ana_sub_anagrams(index, word_signature(input), 1, matches,
+                                      index->header->num_groups);
+    for (int m = 0; m < num_groups; m++) {
+        const anaGroup *group = &index->groups[matches[m]];
+        for (uint32_t i = 0; i < group->word_count; i++) printf("%s ", ana_word(index, group, i));
+    }
+    if (num_groups == 0) {
+        printf("None");
+    }
+    printf("\n");
+    free(matches);
+}
+
+/**
+ * Prints the phrases that use exactly the letters of the input, one per line
+ * (interactive -p mode), and whether the search hit its limits.
+ * @param index Index to take words from.
+ * @param input The phrase to rearrange.
+ */
+static void print_phrases(const anaIndex *index, const char *input) {
+    phraseOptions options;
+    default_phrase_options(&options);
+    phraseResults *results = solve_phrase(index, input, &options);
+    if (!results) return;
+    if (results->saturated) {
+        printf("Phrases from '%s': none searched (more than 15 of a letter)\n", input);
+        free_phrase_results(results);
+        return;
+    }
+    printf("Phrases from '%s': %s%d%s\n", input, results->truncated ? "at least " : "",
+           results->count, results->truncated ? " (search limit reached)" : "");
+    for (int r = 0; r < results->count; r++) {
+        printf("  ");
+        print_phrase(stdout, index, results, r);
+        printf("\n");
+    }
+    free_phrase_results(results);
+}
+
+int main(int argc, char *argv[]) {
+    const char *query_path = NULL;  // Set by -b: answer these queries without prompting
+    int num_threads = 1;
+    int mode = QUERY_ANAGRAMS;      // -s or -p pick another kind of query
+    int opt;
+    while ((opt = getopt(argc, argv, "b:pst:")) != -1) {
+        if (opt == 'b') query_path = optarg;
+        else if (opt == 's') mode = QUERY_SUB_ANAGRAMS;
+        else if (opt == 'p') mode = QUERY_PHRASES;
+        else if (opt == 't') num_threads = atoi(optarg);
+        else break;
+    }
+    if (opt != -1 || argc - optind > 1) {
+        fprintf(stderr, "Usage: %s [-s | -p] [-b queries | -] [-t threads] [wordlist | index file]\n", argv[0]);
+        fprintf(stderr, "  -s  sub-anagrams: every word that can be spelled from the query's letters\n");
+        fprintf(stderr, "  -p  phrases: multi-word anagrams of the query (words of 3+ letters, up to 4 words)\n");
+        fprintf(stderr, "  -b  batch mode: answer each line of the file (- for stdin) as query<TAB>count<TAB>anagrams...\n");
+        fprintf(stderr, "  -t  batch threads (0 = one per CPU)\n");
         return 1;
     }
+    const char *filename = optind < argc ? argv[optind] : "words2.txt";  // Word list or anabuild index
+
+    anaIndex *index = load_index(filename);
+    if (!index) return 1;
+
+    if (query_path) {
+        int status = run_batch(index, query_path, num_threads, mode);
+        close_anagram_index(index);
+        return status;
+    }
 
     // Start an interactive loop to let the user query anagrams
     while (1) {
@@ -71,42 +404,37 @@ int main() {
             break;  // User pressed Enter with no text, so quit
         }
 
-        // Create a sorted version of the input word (e.g., "tea" → "aet")
-        char *key = sorted(input);
-        if (!key) {
-            fprintf(stderr, "Failed to sort input word\n");  
-            continue;  // Skip to next loop iteration
+        if (mode != QUERY_PHRASES && !sig_exact(word_signature(input))) {
+            printf("'%s' has more than 15 of a letter, which the index can't count\n", input);
+            continue;
+        }
+        if (mode == QUERY_SUB_ANAGRAMS) {
+            print_sub_anagrams(index, input);
+            continue;
+        }
+        if (mode == QUERY_PHRASES) {
+            print_phrases(index, input);
+            continue;
         }
 
-        // Look for an anagram group matching the sorted key
-        nodePrimary *group = find_group(anagram_list, key);
+        // Look for an anagram group with the same letter counts (e.g., "tea" and "eat")
+        const anaGroup *group = ana_find_group(index, word_signature(input));
         printf("Anagrams of '%s': ", input);  // Show the word being queried
-        if (group && group->words) {  // Check if a group exists with words
-            int found = 0;  // Flag to track if we find any anagrams
-            for (node *word_node = group->words; word_node != NULL; word_node = word_node->next) {
-                // Skip the input word itself (case-insensitive comparison)
-                if (word_node->word && strcasecmp(word_node->word, input) != 0) {
-                    printf("%s ", word_node->word);
-                    found = 1;  // Mark that we found at least one
-                }
-            }
-            if (!found) {
-                printf("None");  
+        int found = 0;  // Flag to track if we find any anagrams
+        for (uint32_t i = 0; group && i < group->word_count; i++) {
+            // Skip the input word itself (case-insensitive comparison)
+            const char *word = ana_word(index, group, i);
+            if (strcasecmp(word, input) != 0) {
+                printf("%s ", word);
+                found = 1;  // Mark that we found at least one
             }
-        } else {
+        }
+        if (!found) {
             printf("None");  
         }
         printf("\n");  
-
-        free(key);  // Free the sorted key to avoid a memory leak
     }
 
-    // Clean up all allocated memory before exiting
-    free_anagram_list(anagram_list);  // Free the anagram list and its contents
-    for (int i = 0; i < num_words; i++) {
-        free(word_list[i]);  // Free each word in the array
-    }
-    free(word_list);  
-
+    close_anagram_index(index);  // Unmap or free the index image
     return 0;  
-}
\ No newline at end of file
+}
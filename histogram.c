@@ -1,9 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
 #include <float.h>
 #include <stdio.h>
 #include <limits.h>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "histogram.h"
 
 /**
  * Computes the number of stars for a histogram bar.
@@ -45,23 +49,35 @@ int get_max_width(int *x, int n) {
 }
 
 /**
- * Prints a histogram with aligned indices.
+ * Writes a histogram with aligned indices to a stream.
+ * @param fptr Stream to write to.
  * @param x Array of indices.
  * @param y Array of values.
  * @param n Number of elements.
  * @param width Maximum bar width.
  */
-void histogram(int *x, double *y, int n, int width) {
+void fhistogram(FILE *fptr, int *x, double *y, int n, int width) {
     double max = find_max(y, n);
     int field_width = get_max_width(x, n);
     for (int i = 0; i < n; i++) {
-        printf("%*d ", field_width, x[i]);  // Align index
+        fprintf(fptr, "%*d ", field_width, x[i]);  // Align index
         int stars = find_star(y[i], width, max);
-        for (int j = 0; j < stars; j++) printf("*");
-        printf("    %g\n", y[i]);
+        for (int j = 0; j < stars; j++) fputc('*', fptr);
+        fprintf(fptr, "    %g\n", y[i]);
     }
 }
 
+/**
+ * Prints a histogram with aligned indices.
+ * @param x Array of indices.
+ * @param y Array of values.
+ * @param n Number of elements.
+ * @param width Maximum bar width.
+ */
+void histogram(int *x, double *y, int n, int width) {
+    fhistogram(stdout, x, y, n, width);
+}
+
 /**
  * Computes frequency of string lengths.
  * @param strings Array of strings.
@@ -84,4 +100,166 @@ int *histogram_lengths(char **strings, int n) {
     for (int i = 0; i < n; i++)  // Count frequencies
         array[strlen(strings[i])]++;
     return array;
+}
+
+/**
+ * Computes frequency of word lengths from the views of a mapped word list.
+ * Lengths come from the views, so no string is scanned.
+ * @param words Array of word views.
+ * @param n Number of words.
+ * @param max_length Pointer to store the longest length seen.
+ * @return Frequency array of max_length + 1 entries, or NULL on failure.
+ */
+int *histogram_view_lengths(const mappedView *words, int n, int *max_length) {
+    *max_length = 0;
+    for (int i = 0; i < n; i++)  // Find max length
+        if (words[i].len > *max_length) *max_length = words[i].len;
+
+    int *array = calloc(*max_length + 1, sizeof(int));
+    if (!array) {
+        printf("Memory allocation failed.\n");
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++)  // Count frequencies
+        array[words[i].len]++;
+    return array;
+}
+
+/**
+ * Adds one line of the given length to a growable count array, growing it if this
+ * is the longest line so far.
+ * @param counts Pointer to the count array (may be reallocated).
+ * @param capacity Pointer to the number of entries in the count array.
+ * @param max_length Pointer to the longest length seen so far.
+ * @param len Length of the line.
+ * @return 0 on success, -1 if memory allocation fails or the line is absurdly long.
+ */
+int add_length_count(long long **counts, long long *capacity, long long *max_length, long long len) {
+    if (len >= *capacity) {
+        long long new_capacity = *capacity > 0 ? *capacity : 64;
+        while (new_capacity <= len) new_capacity *= 2;
+        if (new_capacity > INT_MAX) {
+            fprintf(stderr, "Error: Line of %lld characters is too long\n", len);
+            return -1;
+        }
+        long long *grown = realloc(*counts, new_capacity * sizeof(long long));
+        if (!grown) {
+            perror("Memory allocation failed");
+            return -1;
+        }
+        memset(grown + *capacity, 0, (new_capacity - *capacity) * sizeof(long long));
+        *counts = grown;
+        *capacity = new_capacity;
+    }
+    (*counts)[len]++;
+    if (len > *max_length) *max_length = len;
+    return 0;
+}
+
+/*
+ * One thread's share of histogram_text_lengths. The worker counts into its own array
+ * held in locals and only writes this struct when it is done, so threads never touch
+ * each other's cache lines while counting.
+ */
+typedef struct lengthWorker {
+    const char *start;        // First line this worker counts
+    const char *end;          // Lines starting here or later belong to the next worker
+    const char *text_end;     // End of the whole text (a line may run past end)
+    long long *counts;        // Private histogram (result)
+    long long max_length;     // Longest line seen (result)
+    long long lines;          // Number of lines counted (result)
+    int failed;               // 1 if counting ran out of memory
+} lengthWorker;
+
+/**
+ * Counts the lengths of the lines starting in one worker's chunk.
+ * @param arg Pointer to the worker's lengthWorker.
+ * @return Always NULL.
+ */
+static void *count_chunk(void *arg) {
+    lengthWorker *worker = arg;
+    long long *counts = NULL, capacity = 0, max_length = 0, lines = 0;
+    int failed = 0;
+    for (const char *p = worker->start; p < worker->end && !failed; lines++) {
+        const char *nl = memchr(p, '\n', worker->text_end - p);
+        const char *line_end = nl ? nl : worker->text_end; // Last line may lack a newline
+        failed = add_length_count(&counts, &capacity, &max_length, line_end - p) == -1;
+        p = line_end + 1;
+    }
+    worker->counts = counts;
+    worker->max_length = max_length;
+    worker->lines = lines;
+    worker->failed = failed;
+    return NULL;
+}
+
+/**
+ * Computes the frequency of line lengths in a block of text using several threads.
+ * The text is cut into one chunk per thread on line boundaries, each thread fills a
+ * private histogram for its chunk, and the histograms are summed at the end, so no
+ * counter is ever shared between threads.
+ * @param text Start of the text (e.g., from map_file).
+ * @param size Size of the text in bytes.
+ * @param num_threads Number of threads (0 or less means one per online CPU).
+ * @param max_length Pointer to store the longest line length.
+ * @param num_lines Pointer to store the number of lines.
+ * @return Frequency array of max_length + 1 entries, or NULL on failure.
+ */
+long long *histogram_text_lengths(const char *text, size_t size, int num_threads, int *max_length, long long *num_lines) {
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    lengthWorker *workers = calloc(num_threads, sizeof(lengthWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!workers || !threads) {
+        perror("Memory allocation failed");
+        free(workers);
+        free(threads);
+        return NULL;
+    }
+
+    // Chunk t starts at the first line that starts at or after t/num_threads of the text
+    const char *text_end = text + size;
+    for (int t = 0; t < num_threads; t++) {
+        const char *start = text + size * t / num_threads;
+        if (t > 0 && start > text) {
+            const char *nl = memchr(start - 1, '\n', text_end - (start - 1));
+            start = nl ? nl + 1 : text_end;
+        }
+        if (t > 0 && start < workers[t - 1].start) start = workers[t - 1].start;
+        workers[t].start = start;
+        workers[t].text_end = text_end;
+        if (t > 0) workers[t - 1].end = start;
+    }
+    workers[num_threads - 1].end = text_end;
+
+    int started = 0;
+    for (; started < num_threads; started++)
+        if (pthread_create(&threads[started], NULL, count_chunk, &workers[started]) != 0) {
+            perror("Failed to start counting thread");
+            break;
+        }
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+
+    // Merge the private histograms
+    int failed = started < num_threads;
+    long long longest = 0, lines = 0;
+    for (int t = 0; t < started; t++) {
+        failed |= workers[t].failed;
+        if (workers[t].max_length > longest) longest = workers[t].max_length;
+        lines += workers[t].lines;
+    }
+    long long *counts = failed ? NULL : calloc(longest + 1, sizeof(long long));
+    if (!failed && !counts) perror("Memory allocation failed");
+    for (int t = 0; t < started; t++) {
+        for (long long i = 0; counts && workers[t].counts && i <= workers[t].max_length; i++)
+            counts[i] += workers[t].counts[i];
+        free(workers[t].counts);
+    }
+    free(workers);
+    free(threads);
+
+    *max_length = (int)longest;
+    *num_lines = lines;
+    return counts;
 }
\ No newline at end of file
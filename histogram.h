@@ -6,10 +6,15 @@
 #include <string.h>
 #include <math.h>
 #include <float.h>
+#include "utils.h"
 
 double find_max(double *x, int n);
 int find_star(double num, int width, double max);
 void histogram(int *x, double *y, int n, int width);
+void fhistogram(FILE *fptr, int *x, double *y, int n, int width);
 int *histogram_lengths(char **strings, int n);
+int *histogram_view_lengths(const mappedView *words, int n, int *max_length);
+int add_length_count(long long **counts, long long *capacity, long long *max_length, long long len);
+long long *histogram_text_lengths(const char *text, size_t size, int num_threads, int *max_length, long long *num_lines);
 
 #endif 
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,7 +6,10 @@
 #include <math.h>
 #include <time.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "patience.h"
+#include "trace.h"
 #include "shuffle.h"
 #include "histogram.h"
 #include "utils.h"
@@ -171,15 +175,16 @@ int count_piles(Pile *head) {
 }
 
 /**
- * Runs the main game loop for Patience, following the rules:
+ * Runs the main game loop for Patience on linked-list piles, following the rules:
  * - Cover pairs adding to 11 or JQK sets with new cards.
  * - Add a new pile if no matches are found.
  * Stops when 9 piles are reached or deck runs out.
+ * This is the original engine, kept as the reference the flat one is checked against.
  * @param deck Pointer to the deck to play with.
  * @param verbose If 1, show annotations for each move; if 0, just pile states.
  * @return Number of cards left in the deck (0 if all used).
  */
-int play(Deck *deck, int verbose) {
+int play_list(Deck *deck, int verbose) {
     Pile *head = NULL, *tail = NULL;
     initialize_game(deck, &head, &tail); // Set up starting piles
 
@@ -259,23 +264,400 @@ int play(Deck *deck, int verbose) {
     return result;
 }
 
+/**
+ * Sets up a flat board with the first two cards of the deck as its two piles,
+ * just as initialize_game does for the linked-list piles.
+ * @param board The board to set up.
+ * @param deck Pointer to the deck to draw from (rewound to its first card).
+ */
+void board_init(Board *board, Deck *deck) {
+    memset(board, 0, sizeof(*board));
+    deck->top = 0; // Reset deck position
+    for (int i = 0; i < 2; i++) {
+        int card = deck->cards[deck->top++];
+        board->tops[board->num_piles++] = card;
+        board->counts[card]++;
+    }
+}
+
+/**
+ * Covers one pile's top card with the next card from the deck, if there is one.
+ * @param board The board.
+ * @param pile Index of the pile to cover.
+ * @param deck Pointer to the deck to draw from.
+ */
+static void board_cover(Board *board, int pile, Deck *deck) {
+    if (deck->top >= 52) return;
+    board->counts[board->tops[pile]]--;
+    board->tops[pile] = deck->cards[deck->top++];
+    board->counts[board->tops[pile]]++;
+}
+
+/**
+ * Works out the move play() would make next on a flat board, without making it.
+ * The value counts say straight away whether any pair or a J, Q, K is showing; only
+ * then are the (at most 9) tops scanned, in the same order and with the same
+ * overwrite-as-you-go lookup as add_to_11 and jqk, so the same piles get picked.
+ * @param board The board.
+ * @param deck The deck.
+ * @param piles Array of at least 18 to receive the piles to cover, in covering order.
+ * @param count Pointer to store the number of piles to cover.
+ * @return The move, or MOVE_NONE if the game is over.
+ */
+Move board_find_move(const Board *board, const Deck *deck, int *piles, int *count) {
+    *count = 0;
+    if (board->num_piles >= 9 || deck->top >= 52) return MOVE_NONE;
+    const int *c = board->counts;
+
+    if ((c[1] && c[10]) || (c[2] && c[9]) || (c[3] && c[8]) || (c[4] && c[7]) || (c[5] && c[6])) {
+        int seen[14] = {0}; // Pile index + 1 of the latest unmatched pile showing each value
+        for (int p = 0; p < board->num_piles; p++) {
+            int val = board->tops[p];
+            int needed = 11 - val;
+            if (needed > 0 && needed <= 10 && seen[needed]) {
+                piles[(*count)++] = seen[needed] - 1;
+                piles[(*count)++] = p;
+                seen[needed] = 0;
+            } else {
+                seen[val] = p + 1;
+            }
+        }
+        return MOVE_PAIRS;
+    }
+
+    if (c[11] && c[12] && c[13]) {
+        piles[0] = piles[1] = piles[2] = -1; // First pile showing J, Q and K
+        for (int p = 0; p < board->num_piles; p++) {
+            int val = board->tops[p];
+            if (val >= 11 && piles[val - 11] < 0) piles[val - 11] = p;
+        }
+        *count = 3;
+        return MOVE_JQK;
+    }
+    return MOVE_NEW_PILE;
+}
+
+/**
+ * Makes a move found by board_find_move: covers the given piles with cards from
+ * the deck (as many as are left), or starts a new pile.
+ * @param board The board.
+ * @param deck Pointer to the deck to draw from.
+ * @param move The move to make.
+ * @param piles Piles to cover, in covering order.
+ * @param count Number of piles to cover.
+ */
+void board_apply(Board *board, Deck *deck, Move move, const int *piles, int count) {
+    if (move == MOVE_NEW_PILE) {
+        int card = deck->cards[deck->top++];
+        board->tops[board->num_piles++] = card;
+        board->counts[card]++;
+        return;
+    }
+    for (int i = 0; i < count; i++) board_cover(board, piles[i], deck);
+}
+
+/**
+ * Plays one turn on a flat board, making exactly the move play() would.
+ * @param board The board.
+ * @param deck Pointer to the deck to draw from.
+ * @return The move made, or MOVE_NONE if the game is already over.
+ */
+Move board_step(Board *board, Deck *deck) {
+    int piles[18], count;
+    Move move = board_find_move(board, deck, piles, &count);
+    if (move != MOVE_NONE) board_apply(board, deck, move, piles, count);
+    return move;
+}
+
+/**
+ * Plays a whole game on a flat board: same rules and result as play(), but with
+ * no printing and no memory allocation.
+ * @param deck Pointer to the deck to play with.
+ * @return Number of cards left in the deck (0 if all used).
+ */
+int play_flat(Deck *deck) {
+    Board board;
+    board_init(&board, deck);
+    while (board_step(&board, deck) != MOVE_NONE) {
+    }
+    return 52 - deck->top;
+}
+
+/**
+ * Plays a game on a flat board, sending each move to a trace sink.
+ * Tracing is the only thing that formats or prints anything, so with no sink (or a
+ * TRACE_NONE one) the game runs with no I/O and no memory allocation.
+ * @param deck Pointer to the deck to play with.
+ * @param sink Where to send the moves (NULL for nowhere).
+ * @return Number of cards left in the deck (0 if all used).
+ */
+int play_traced(Deck *deck, TraceSink *sink) {
+    int tracing = sink && sink->kind != TRACE_NONE;
+    Board board;
+    board_init(&board, deck);
+    while (1) {
+        int piles[18], count;
+        Move move = board_find_move(&board, deck, piles, &count);
+        if (move == MOVE_NONE) break;
+        if (tracing) trace_move(sink, &board, deck, move, piles, count);
+        board_apply(&board, deck, move, piles, count);
+    }
+    if (tracing) trace_end(sink, &board, deck);
+    return 52 - deck->top;
+}
+
+/**
+ * Plays a game and prints every board state, as a text trace on stdout.
+ * @param deck Pointer to the deck to play with.
+ * @param verbose If 1, show annotations for each move; if 0, just pile states.
+ * @return Number of cards left in the deck (0 if all used).
+ */
+int play(Deck *deck, int verbose) {
+    TraceSink sink;
+    trace_open(&sink, TRACE_TEXT, stdout, verbose);
+    int result = play_traced(deck, &sink);
+    trace_close(&sink);
+    return result;
+}
+
 /**
  * Plays the game multiple times and counts how often each number of cards remains.
  * Each game starts with a shuffled deck, and results are tallied in an array.
+ * Every game's moves go to the sink, with text traces separated by a blank line.
  * @param n Number of games to simulate.
+ * @param sink Where to send the moves (NULL or TRACE_NONE for silent games).
  * @return Array where index is cards left, value is frequency of that outcome.
  */
-int *many_plays(int n) {
+int *many_plays_traced(int n, TraceSink *sink) {
     int *remaining = calloc(53, sizeof(int)); // Space for 0-52 cards left
+    if (!remaining) {
+        perror("Memory allocation failed for results");
+        exit(1);
+    }
     int seed = -1; // Start with random shuffle, then use fixed seed
     for (int i = 0; i < n; i++) {
         Deck deck = initialize_deck();
         shuffle(deck.cards, 52, seed); // Shuffle (random first time, then repeatable)
         seed = 0; // Fix seed after first game
-        int left = play(&deck, 1); // Play with verbose output
+        int left = play_traced(&deck, sink);
         remaining[left]++; // Record how many cards were left
-        printf("\n");
+        if (sink && sink->kind == TRACE_TEXT) fputc('\n', sink->out);
+    }
+    return remaining;
+}
+
+/**
+ * Plays the game multiple times, printing every annotated board to stdout.
+ * @param n Number of games to simulate.
+ * @return Array where index is cards left, value is frequency of that outcome.
+ */
+int *many_plays(int n) {
+    TraceSink sink;
+    trace_open(&sink, TRACE_TEXT, stdout, 1);
+    int *remaining = many_plays_traced(n, &sink);
+    trace_close(&sink);
+    return remaining;
+}
+
+// One thread's share of a parallel run: a contiguous range of game indices
+typedef struct playWorker {
+    uint64_t seed;          // Seed for the whole run
+    long long first;        // Index of the first game to play
+    long long count;        // Number of games to play
+    long long remaining[53]; // This thread's outcome histogram
+} playWorker;
+
+/**
+ * Plays one thread's range of games silently, tallying them in its own histogram.
+ * Game i is shuffled by a generator seeded with game_seed(seed, i), so it comes out
+ * the same on any thread.
+ * @param arg Pointer to the thread's playWorker.
+ * @return NULL.
+ */
+static void *play_worker(void *arg) {
+    playWorker *w = arg;
+    for (long long i = w->first; i < w->first + w->count; i++) {
+        Rng rng;
+        rng_seed(&rng, game_seed(w->seed, i));
+        Deck deck = initialize_deck();
+        shuffle_fy(deck.cards, 52, &rng);
+        w->remaining[play_traced(&deck, NULL)]++;
+    }
+    return NULL;
+}
+
+/**
+ * Plays the game n times across several threads and counts how often each number
+ * of cards remains. Every game's shuffle comes from its own index and the seed,
+ * and the per-thread histograms are only added up at the end, so a given seed
+ * gives exactly the same counts whatever the number of threads.
+ * @param n Number of games to simulate.
+ * @param seed Seed for the run.
+ * @param num_threads Number of threads to use (0 means one per CPU).
+ * @return Array where index is cards left, value is frequency of that outcome.
+ */
+long long *many_plays_parallel(long long n, uint64_t seed, int num_threads) {
+    return many_plays_range(0, n, seed, num_threads);
+}
+
+/**
+ * Like many_plays_parallel, but plays games first to first + n - 1 of the seed's
+ * sequence. Running consecutive ranges and adding the histograms gives exactly
+ * what one many_plays_parallel call over all of them would.
+ * @param first Index of the first game to play.
+ * @param n Number of games to simulate.
+ * @param seed Seed for the run.
+ * @param num_threads Number of threads to use (0 means one per CPU).
+ * @return Array where index is cards left, value is frequency of that outcome.
+ */
+long long *many_plays_range(long long first, long long n, uint64_t seed, int num_threads) {
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    long long *remaining = calloc(53, sizeof(long long)); // Space for 0-52 cards left
+    playWorker *workers = calloc(num_threads, sizeof(playWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!remaining || !workers || !threads) {
+        perror("Memory allocation failed for parallel plays");
+        exit(1);
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].seed = seed;
+        workers[t].first = first + n * t / num_threads;
+        workers[t].count = first + n * (t + 1) / num_threads - workers[t].first;
+        if (t > 0 && pthread_create(&threads[t], NULL, play_worker, &workers[t]) != 0) {
+            perror("Failed to start simulation thread");
+            exit(1);
+        }
+    }
+    play_worker(&workers[0]); // The main thread takes the first range itself
+    for (int t = 1; t < num_threads; t++) pthread_join(threads[t], NULL);
+
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < 53; i++) remaining[i] += workers[t].remaining[i];
+    }
+    free(workers);
+    free(threads);
+    return remaining;
+}
+
+/**
+ * Fills in the standard rules: pairs adding to 11, 9 piles, J, Q, K covered.
+ * @param rules The rules to fill in.
+ */
+void default_rules(Rules *rules) {
+    rules->target = 11;
+    rules->max_piles = 9;
+    rules->jqk = 1;
+}
+
+/**
+ * Plays a deck of any size under a variant of the rules: the flat engine of
+ * pengine.h with every rule as a runtime parameter. pspec.c instantiates the same
+ * body with the rules as constants.
+ * @param cards The cards, in the order they are drawn (values 1-13).
+ * @param size Number of cards.
+ * @param rules The rules (max_piles at most RULES_MAX_PILES).
+ * @return Cards left in the deck at the end of the game.
+ */
+#define ENGINE_NAME play_cards
+#define ENGINE_PARAMS , int size, const Rules *rules
+#define ENGINE_DECK_SIZE size
+#define ENGINE_MAX_PILES rules->max_piles
+#define ENGINE_TARGET rules->target
+#define ENGINE_JQK rules->jqk
+#define ENGINE_PILE_CAP RULES_MAX_PILES
+#include "pengine.h"
+
+/**
+ * Plays a game under a variant of the rules. With default_rules it plays exactly
+ * the game play() would. Only number cards pair up, as with the standard target of
+ * 11, whatever the target.
+ * @param deck The deck to play.
+ * @param rules The rules.
+ * @return Cards left in the deck at the end of the game.
+ */
+int play_rules(Deck *deck, const Rules *rules) {
+    int left = play_cards(deck->cards, 52, rules);
+    deck->top = 52 - left;
+    return left;
+}
+
+// One thread's share of a sweep: a contiguous range of decks, each played under every rule set
+typedef struct sweepWorker {
+    uint64_t seed;
+    long long first;
+    long long count;
+    const Rules *rules;
+    int num_rules;
+    long long *remaining;   // This thread's histograms, 53 per rule set
+} sweepWorker;
+
+/**
+ * Shuffles one thread's range of decks and plays each under every rule set.
+ * @param arg Pointer to the thread's sweepWorker.
+ * @return NULL.
+ */
+static void *sweep_worker(void *arg) {
+    sweepWorker *w = arg;
+    for (long long i = w->first; i < w->first + w->count; i++) {
+        Rng rng;
+        rng_seed(&rng, game_seed(w->seed, i));
+        Deck deck = initialize_deck();
+        shuffle_fy(deck.cards, 52, &rng);
+        for (int r = 0; r < w->num_rules; r++) {
+            w->remaining[r * 53 + play_rules(&deck, &w->rules[r])]++;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Plays n games under each of several rule sets, on the same decks: deck i is
+ * shuffled once (exactly as many_plays_parallel shuffles game i) and played under
+ * every rule set. Besides saving the shuffles, this makes the differences between
+ * rule sets much less noisy than separate runs would, since they see the same deals.
+ * @param n Number of decks.
+ * @param seed Seed for the run.
+ * @param num_threads Number of threads to use (0 means one per CPU).
+ * @param rules The rule sets.
+ * @param num_rules Number of rule sets.
+ * @return Array of num_rules * 53 counts: element r * 53 + k is how many games left
+ *         k cards under rule set r.
+ */
+long long *sweep_plays(long long n, uint64_t seed, int num_threads, const Rules *rules, int num_rules) {
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    long long *remaining = calloc((size_t)num_rules * 53, sizeof(long long));
+    long long *counts = calloc((size_t)num_threads * num_rules * 53, sizeof(long long));
+    sweepWorker *workers = calloc(num_threads, sizeof(sweepWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!remaining || !counts || !workers || !threads) {
+        perror("Memory allocation failed for sweep");
+        exit(1);
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].seed = seed;
+        workers[t].first = n * t / num_threads;
+        workers[t].count = n * (t + 1) / num_threads - workers[t].first;
+        workers[t].rules = rules;
+        workers[t].num_rules = num_rules;
+        workers[t].remaining = counts + (size_t)t * num_rules * 53;
+        if (t > 0 && pthread_create(&threads[t], NULL, sweep_worker, &workers[t]) != 0) {
+            perror("Failed to start simulation thread");
+            exit(1);
+        }
+    }
+    sweep_worker(&workers[0]); // The main thread takes the first range itself
+    for (int t = 1; t < num_threads; t++) pthread_join(threads[t], NULL);
+
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < num_rules * 53; i++) remaining[i] += workers[t].remaining[i];
     }
+    free(counts);
+    free(workers);
+    free(threads);
     return remaining;
 }
 
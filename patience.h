@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 // Structure for a card node in a pile.
 typedef struct CardNode {
@@ -22,6 +23,33 @@ typedef struct Deck {
     int top;
 } Deck;
 
+// Flat game state for the allocation-free engine: the visible pile tops in pile
+// order (there are never more than 9), plus how many of each value are showing.
+typedef struct Board {
+    int tops[9];
+    int num_piles;
+    int counts[14];
+} Board;
+
+// What a turn of the game did.
+typedef enum Move {
+    MOVE_NONE,      // Game over: 9 piles or no cards left
+    MOVE_PAIRS,     // Covered pairs adding to 11
+    MOVE_JQK,       // Covered a Jack, Queen and King
+    MOVE_NEW_PILE   // Started a new pile
+} Move;
+
+// A variant of the rules, for play_rules; default_rules gives the standard game.
+#define RULES_MAX_PILES 16
+typedef struct Rules {
+    int target;     // Two number cards (1-10) showing that add up to this are covered
+    int max_piles;  // The game ends when this many piles are showing (2 to RULES_MAX_PILES)
+    int jqk;        // 1 if a J, Q and K showing are covered, 0 if they never are
+} Rules;
+
+// Destination for the moves of a game (see trace.h).
+typedef struct TraceSink TraceSink;
+
 int draw_from_deck(Deck* deck);
 void add_pile(Pile** head, Pile** tail, int card);
 Pile** add_to_11(Pile *visible_piles, int *num_piles_to_cover);
@@ -30,8 +58,22 @@ void cover_cards(Pile** piles, int count, Deck* deck, int verbose);
 Deck initialize_deck(void);
 void initialize_game(Deck* deck, Pile** head, Pile** tail);
 int count_piles(Pile *head);
+int play_list(Deck* deck, int verbose);
 int play(Deck* deck, int verbose);
+void board_init(Board* board, Deck* deck);
+Move board_find_move(const Board* board, const Deck* deck, int* piles, int* count);
+void board_apply(Board* board, Deck* deck, Move move, const int* piles, int count);
+Move board_step(Board* board, Deck* deck);
+int play_flat(Deck* deck);
+int play_traced(Deck* deck, TraceSink* sink);
+int* many_plays_traced(int n, TraceSink* sink);
 int* many_plays(int n);
+long long* many_plays_parallel(long long n, uint64_t seed, int num_threads);
+long long* many_plays_range(long long first, long long n, uint64_t seed, int num_threads);
+void default_rules(Rules* rules);
+int play_cards(const int* cards, int size, const Rules* rules);
+int play_rules(Deck* deck, const Rules* rules);
+long long* sweep_plays(long long n, uint64_t seed, int num_threads, const Rules* rules, int num_rules);
 int *get_labels(int *num_labels);
 double *get_percentages(int *results, int num_games, int num_labels);
 
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "patience.h"
+#include "pbatch.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Lockstep patience: BATCH_LANES games advance one turn at a time together, with
+ * their state stored as structure-of-arrays lanes (element l of every vector belongs
+ * to game lane l). The vectors use GCC's vector extensions, so the compares below
+ * compile to SIMD instructions wherever the target has them (SSE2 on x86-64) and to
+ * plain loops elsewhere.
+ */
+typedef uint8_t laneVec __attribute__((vector_size(BATCH_LANES)));
+
+typedef struct batchBoard {
+    laneVec counts[14];             // counts[v][l]: cards of value v showing in lane l
+    laneVec num_piles;              // Piles in each lane
+    laneVec drawn;                  // Cards drawn from each lane's deck
+    laneVec live;                   // 0xFF for lanes with a game in progress
+    uint8_t tops[9][BATCH_LANES];   // tops[p][l]: top card of pile p in lane l
+    Deck *deck[BATCH_LANES];        // Deck each lane is playing
+    int game[BATCH_LANES];          // Index of that deck in the batch
+} batchBoard;
+
+/**
+ * Turns a lane mask (0xFF or 0 per lane) into a bitmask with bit l set for lane l.
+ * @param mask The lane mask.
+ * @return The bitmask.
+ */
+static inline uint32_t lane_bits(laneVec mask) {
+#if defined(__SSE2__) && BATCH_LANES == 16
+    return (uint32_t)_mm_movemask_epi8((__m128i)mask);
+#else
+    uint32_t bits = 0;
+    for (int l = 0; l < BATCH_LANES; l++) bits |= (uint32_t)(mask[l] & 1) << l;
+    return bits;
+#endif
+}
+
+/**
+ * Starts a game in a lane: its first two cards become its two piles.
+ * @param b The batch board.
+ * @param l The lane.
+ * @param deck The deck to play.
+ * @param game Index of the deck in the batch.
+ */
+static void lane_start(batchBoard *b, int l, Deck *deck, int game) {
+    for (int v = 0; v < 14; v++) b->counts[v][l] = 0;
+    deck->top = 2;
+    b->deck[l] = deck;
+    b->game[l] = game;
+    b->tops[0][l] = deck->cards[0];
+    b->tops[1][l] = deck->cards[1];
+    b->counts[deck->cards[0]][l]++;
+    b->counts[deck->cards[1]][l]++;
+    b->num_piles[l] = 2;
+    b->drawn[l] = 2;
+    b->live[l] = 0xFF;
+}
+
+/**
+ * Covers one pile of a lane with the next card of its deck, if there is one.
+ * @param b The batch board.
+ * @param l The lane.
+ * @param pile The pile to cover.
+ */
+static inline void lane_cover(batchBoard *b, int l, int pile) {
+    Deck *deck = b->deck[l];
+    if (deck->top >= 52) return;
+    int card = deck->cards[deck->top++];
+    b->counts[b->tops[pile][l]][l]--;
+    b->tops[pile][l] = card;
+    b->counts[card][l]++;
+}
+
+/**
+ * Makes one lane's move once the vector checks have said which kind it is. Pairs
+ * and J, Q, K are picked by the same scans as board_find_move, so every lane plays
+ * exactly the game play() would.
+ * @param b The batch board.
+ * @param l The lane.
+ * @param move MOVE_PAIRS, MOVE_JQK or MOVE_NEW_PILE.
+ */
+static void lane_move(batchBoard *b, int l, Move move) {
+    int num_piles = b->num_piles[l];
+    if (move == MOVE_PAIRS) {
+        int seen[14] = {0}; // Pile index + 1 of the latest unmatched pile showing each value
+        int piles[18], count = 0;
+        for (int p = 0; p < num_piles; p++) {
+            int val = b->tops[p][l];
+            int needed = 11 - val;
+            if (needed > 0 && needed <= 10 && seen[needed]) {
+                piles[count++] = seen[needed] - 1;
+                piles[count++] = p;
+                seen[needed] = 0;
+            } else {
+                seen[val] = p + 1;
+            }
+        }
+        for (int i = 0; i < count; i++) lane_cover(b, l, piles[i]);
+    } else if (move == MOVE_JQK) {
+        int first[3] = {-1, -1, -1}; // First pile showing J, Q and K
+        for (int p = 0; p < num_piles; p++) {
+            int val = b->tops[p][l];
+            if (val >= 11 && first[val - 11] < 0) first[val - 11] = p;
+        }
+        for (int i = 0; i < 3; i++) lane_cover(b, l, first[i]);
+    } else {
+        Deck *deck = b->deck[l];
+        int card = deck->cards[deck->top++];
+        b->tops[num_piles][l] = card;
+        b->counts[card][l]++;
+        b->num_piles[l] = num_piles + 1;
+    }
+    b->drawn[l] = b->deck[l]->top;
+}
+
+/**
+ * Plays a batch of games in lockstep, BATCH_LANES at a time, with the same rules
+ * and results as play(). Every turn, vector compares across all lanes find which
+ * games are over, which show a pair adding to 11 and which show a J, Q and K; then
+ * each live lane makes its move. A lane whose game ends is refilled with the next
+ * deck, or masked off once there are none left.
+ * @param decks The decks to play (their top positions are used as cursors).
+ * @param n Number of decks.
+ * @param left Array of n to receive the cards left in each deck.
+ */
+void play_batch(Deck *decks, int n, int *left) {
+    batchBoard b;
+    memset(&b, 0, sizeof(b));
+    int next = 0;
+    for (int l = 0; l < BATCH_LANES && next < n; l++, next++) lane_start(&b, l, &decks[next], next);
+
+    const laneVec zero = {0}, nine = zero + 9, full = zero + 52;
+    while (lane_bits(b.live)) {
+        // Finished games: 9 piles or an empty deck
+        laneVec over = b.live & (laneVec)((b.num_piles >= nine) | (b.drawn >= full));
+        for (uint32_t bits = lane_bits(over); bits; bits &= bits - 1) {
+            int l = __builtin_ctz(bits);
+            left[b.game[l]] = 52 - b.drawn[l];
+            if (next < n) {
+                lane_start(&b, l, &decks[next], next);
+                next++;
+            } else {
+                b.live[l] = 0;
+            }
+        }
+
+        // Which lanes show a pair adding to 11, and which show J, Q and K
+        laneVec pairs = zero, jqk;
+        for (int v = 1; v <= 5; v++) pairs |= (laneVec)((b.counts[v] != zero) & (b.counts[11 - v] != zero));
+        jqk = (laneVec)((b.counts[11] != zero) & (b.counts[12] != zero) & (b.counts[13] != zero));
+
+        uint32_t live = lane_bits(b.live), pair_bits = lane_bits(pairs) & live;
+        uint32_t jqk_bits = lane_bits(jqk) & live & ~pair_bits;
+        for (uint32_t bits = live; bits; bits &= bits - 1) {
+            int l = __builtin_ctz(bits);
+            Move move = pair_bits >> l & 1 ? MOVE_PAIRS : jqk_bits >> l & 1 ? MOVE_JQK : MOVE_NEW_PILE;
+            lane_move(&b, l, move);
+        }
+    }
+}
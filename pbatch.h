@@ -0,0 +1,10 @@
+#ifndef PBATCH_H
+#define PBATCH_H
+
+#include "patience.h"
+
+#define BATCH_LANES 16 // Games played side by side
+
+void play_batch(Deck *decks, int n, int *left);
+
+#endif
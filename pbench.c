@@ -0,0 +1,251 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "pbatch.h"
+#include "pspec.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing benchmark runs.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Times the shuffles on a 52-card deck: the original sort-by-random-key shuffle()
+ * (process-wide random()), and the Fisher-Yates shuffle_fy and shuffle_batch,
+ * reported as shuffles per second.
+ * @param n Number of shuffles per method.
+ */
+static void bench_shuffles(int n) {
+    enum { BLOCK = 1024 }; // Decks per shuffle_batch call
+    int *cards = malloc(BLOCK * 52 * sizeof(int));
+    if (!cards) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (int i = 0; i < BLOCK * 52; i++) cards[i] = i % 52;
+    Deck deck = initialize_deck();
+    int checksum = 0; // Keeps the shuffles from being optimised away
+    printf("\nShuffles of a 52-card deck (%d per method)\n", n);
+    printf("%-16s %10s %14s\n", "method", "seconds", "shuffles/s");
+
+    double t0 = now();
+    for (int i = 0; i < n; i++) {
+        shuffle(deck.cards, 52, i == 0 ? 1 : 0);
+        checksum += deck.cards[0];
+    }
+    double base = now() - t0;
+    printf("%-16s %10.4f %14.0f\n", "shuffle", base, n / base);
+
+    Rng rng;
+    rng_seed(&rng, 1);
+    t0 = now();
+    for (int i = 0; i < n; i++) {
+        shuffle_fy(deck.cards, 52, &rng);
+        checksum += deck.cards[0];
+    }
+    double elapsed = now() - t0;
+    printf("%-16s %10.4f %14.0f %6.1fx\n", "shuffle_fy", elapsed, n / elapsed, base / elapsed);
+
+    t0 = now();
+    for (int done = 0; done < n; done += BLOCK) {
+        int count = n - done < BLOCK ? n - done : BLOCK;
+        shuffle_batch(cards, 52, count, &rng);
+        checksum += cards[0];
+    }
+    elapsed = now() - t0;
+    printf("%-16s %10.4f %14.0f %6.1fx\n", "shuffle_batch", elapsed, n / elapsed, base / elapsed);
+    if (checksum == -1) printf("\n"); // Never true; uses the checksum
+    free(cards);
+}
+
+/**
+ * Times each compile-time specialised engine (pspec.c) against the runtime-generic
+ * play_cards on the same shuffled decks of its size, and checks they agree.
+ * @param n Number of games per engine.
+ * @param seed Seed for the shuffles.
+ * @return Number of games where the two engines disagree.
+ */
+static int bench_specialized(int n, uint64_t seed) {
+    printf("\nSpecialised engines vs play_cards (%d games each)\n", n);
+    printf("%-17s %12s %12s %10s %10s\n", "deck/piles/target", "generic/s", "special/s", "speedup", "identical");
+    int mismatches = 0;
+    for (int e = 0; e < num_spec_engines; e++) {
+        const specEngine *engine = &spec_engines[e];
+        int size = engine->deck_size;
+        int *cards = malloc((size_t)n * size * sizeof(int));
+        if (!cards) {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+        Rng rng;
+        rng_seed(&rng, seed);
+        for (int i = 0; i < n; i++) {
+            initialize_cards(cards + (size_t)i * size, size);
+            shuffle_fy(cards + (size_t)i * size, size, &rng);
+        }
+        Rules rules = {engine->target, engine->max_piles, 1};
+
+        long long generic_sum = 0, special_sum = 0;
+        double t0 = now();
+        for (int i = 0; i < n; i++) generic_sum += play_cards(cards + (size_t)i * size, size, &rules);
+        double generic_time = now() - t0;
+        t0 = now();
+        for (int i = 0; i < n; i++) special_sum += engine->play(cards + (size_t)i * size);
+        double special_time = now() - t0;
+
+        int differ = 0;
+        for (int i = 0; i < n && generic_sum == special_sum; i++) {
+            differ += play_cards(cards + (size_t)i * size, size, &rules) != engine->play(cards + (size_t)i * size);
+        }
+        if (generic_sum != special_sum) differ = 1;
+        mismatches += differ;
+        printf("%-17s %12.0f %12.0f %9.2fx %10s\n", engine->name, n / generic_time, n / special_time,
+               generic_time / special_time, differ ? "NO" : "yes");
+        free(cards);
+    }
+    return mismatches;
+}
+
+/**
+ * Times many_plays_parallel over 1..max_threads threads and checks that every thread
+ * count gives exactly the same outcome histogram.
+ * @param n Number of games per run.
+ * @param seed Seed for the runs.
+ * @param max_threads Largest thread count to try.
+ */
+static void bench_parallel(long long n, uint64_t seed, int max_threads) {
+    printf("\nParallel many_plays over %lld games (seed %llu)\n", n, (unsigned long long)seed);
+    printf("%-10s %10s %14s %10s %10s\n", "threads", "seconds", "games/s", "speedup", "identical");
+    long long *reference = NULL;
+    double base = 0;
+    for (int t = 1; t <= max_threads; t++) {
+        double t0 = now();
+        long long *remaining = many_plays_parallel(n, seed, t);
+        double elapsed = now() - t0;
+        if (!reference) {
+            reference = remaining;
+            base = elapsed;
+        }
+        int identical = memcmp(remaining, reference, 53 * sizeof(long long)) == 0;
+        printf("%-10d %10.4f %14.0f %10.2f %10s\n", t, elapsed, n / elapsed, base / elapsed,
+               identical ? "yes" : "NO");
+        if (remaining != reference) free(remaining);
+    }
+    free(reference);
+}
+
+/**
+ * Times the linked-list engine (play_list) against the flat engine (play_flat and
+ * untraced play_traced) and the lockstep play_batch on the same shuffled decks, and
+ * checks they all leave the same number of cards every game. play_list() always
+ * prints the piles, so its output goes to /dev/null while it runs. Then times the
+ * specialised engines, the parallel simulation and the shuffles.
+ */
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 100000;  // Number of games
+    int seed = argc > 2 ? atoi(argv[2]) : 1;    // Seed for the first shuffle
+    int max_threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1 || seed < 1 || max_threads < 1) {
+        fprintf(stderr, "Usage: %s [games] [seed > 0] [max threads]\n", argv[0]);
+        return 1;
+    }
+
+    // Shuffle every deck up front so every engine plays identical games
+    Deck *decks = malloc(n * sizeof(Deck));
+    int *list_left = malloc(n * sizeof(int));
+    int *flat_left = malloc(n * sizeof(int));
+    int *traced_left = malloc(n * sizeof(int));
+    int *batch_left = malloc(n * sizeof(int));
+    if (!decks || !list_left || !flat_left || !traced_left || !batch_left) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        decks[i] = initialize_deck();
+        shuffle(decks[i].cards, 52, i == 0 ? seed : 0); // Seed once, then keep going
+    }
+
+    // Linked-list engine, with its printing thrown away
+    fflush(stdout);
+    int saved_stdout = dup(fileno(stdout));
+    if (saved_stdout == -1 || !freopen("/dev/null", "w", stdout)) {
+        perror("Redirecting stdout failed");
+        exit(1);
+    }
+    double t0 = now();
+    for (int i = 0; i < n; i++) {
+        Deck deck = decks[i];
+        list_left[i] = play_list(&deck, 0);
+    }
+    fflush(stdout);
+    double list_time = now() - t0;
+    if (dup2(saved_stdout, fileno(stdout)) == -1) {
+        perror("dup2 failed");
+        exit(1);
+    }
+    close(saved_stdout);
+
+    // Flat engine
+    t0 = now();
+    for (int i = 0; i < n; i++) {
+        Deck deck = decks[i];
+        flat_left[i] = play_flat(&deck);
+    }
+    double flat_time = now() - t0;
+
+    // Flat engine through the trace hook, with tracing off
+    t0 = now();
+    for (int i = 0; i < n; i++) {
+        Deck deck = decks[i];
+        traced_left[i] = play_traced(&deck, NULL);
+    }
+    double traced_time = now() - t0;
+
+    // Lockstep batches (play_batch moves the decks' cursors, so give it copies)
+    Deck *copies = malloc(n * sizeof(Deck));
+    if (!copies) {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+    memcpy(copies, decks, n * sizeof(Deck));
+    t0 = now();
+    play_batch(copies, n, batch_left);
+    double batch_time = now() - t0;
+    free(copies);
+
+    int mismatches = 0;
+    for (int i = 0; i < n; i++) {
+        mismatches += list_left[i] != flat_left[i] || list_left[i] != traced_left[i] ||
+                      list_left[i] != batch_left[i];
+    }
+
+    printf("Patience engines over %d games (seed %d)\n", n, seed);
+    printf("%-12s %10s %14s\n", "engine", "seconds", "games/s");
+    printf("%-12s %10.4f %14.0f\n", "linked list", list_time, n / list_time);
+    printf("%-12s %10.4f %14.0f\n", "flat", flat_time, n / flat_time);
+    printf("%-12s %10.4f %14.0f\n", "untraced", traced_time, n / traced_time);
+    printf("%-12s %10.4f %14.0f %8.2fx flat\n", "batch", batch_time, n / batch_time, flat_time / batch_time);
+    printf("speedup %.1fx, %s\n", list_time / flat_time,
+           mismatches ? "RESULTS DIFFER" : "results identical");
+
+    mismatches += bench_specialized(10 * n, seed);
+    bench_parallel(10LL * n, seed, max_threads);
+    bench_shuffles(10 * n);
+
+    free(decks);
+    free(list_left);
+    free(flat_left);
+    free(traced_left);
+    free(batch_left);
+    return mismatches != 0;
+}
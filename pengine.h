@@ -0,0 +1,87 @@
+/*
+ * Body of a flat patience engine, to be included once per engine wanted (so there
+ * is no include guard). The includer defines:
+ *
+ *   ENGINE_NAME       name of the function to define
+ *   ENGINE_PARAMS     its parameters after the cards (empty, or starting with a comma)
+ *   ENGINE_DECK_SIZE  cards in the deck
+ *   ENGINE_MAX_PILES  the game ends when this many piles are showing
+ *   ENGINE_TARGET     two number cards adding up to this are covered
+ *   ENGINE_JQK        1 if a J, Q and K showing are covered
+ *   ENGINE_PILE_CAP   size of the pile arrays (at least ENGINE_MAX_PILES)
+ *
+ * Each may be a constant, giving an engine specialised for one configuration whose
+ * loops and bounds the compiler can fold and unroll, or an expression on the
+ * parameters, giving a runtime-configurable engine. Either way the function is
+ *
+ *   int ENGINE_NAME(const int *cards ENGINE_PARAMS)
+ *
+ * which plays the cards in order (values 1-13) and returns how many are left in the
+ * deck at the end. The piles are scanned as in board_find_move, so with a 52-card
+ * deck, 9 piles, a target of 11 and J, Q, K on it plays exactly the game play() would.
+ * The macros are undefined again at the end.
+ */
+
+int ENGINE_NAME(const int *cards ENGINE_PARAMS) {
+    const int deck_size = ENGINE_DECK_SIZE, max_piles = ENGINE_MAX_PILES;
+    const int target = ENGINE_TARGET, jqk = ENGINE_JQK;
+    int tops[ENGINE_PILE_CAP], counts[14] = {0}, num_piles = 0, top = 0;
+    for (int i = 0; i < 2; i++) {
+        int card = cards[top++];
+        tops[num_piles++] = card;
+        counts[card]++;
+    }
+
+    while (num_piles < max_piles && top < deck_size) {
+        int piles[ENGINE_PILE_CAP], count = 0;
+
+        // Is any pair showing? Check the counts before scanning the piles
+        int pairs = 0;
+        for (int v = 1; v <= 10 && !pairs; v++) {
+            int w = target - v;
+            if (w >= v && w <= 10) pairs = w == v ? counts[v] >= 2 : counts[v] && counts[w];
+        }
+        if (pairs) {
+            int seen[14] = {0}; // Pile index + 1 of the latest unmatched pile showing each value
+            for (int p = 0; p < num_piles; p++) {
+                int val = tops[p];
+                int needed = target - val;
+                if (val <= 10 && needed > 0 && needed <= 10 && seen[needed]) {
+                    piles[count++] = seen[needed] - 1;
+                    piles[count++] = p;
+                    seen[needed] = 0;
+                } else {
+                    seen[val] = p + 1;
+                }
+            }
+        } else if (jqk && counts[11] && counts[12] && counts[13]) {
+            piles[0] = piles[1] = piles[2] = -1; // First pile showing J, Q and K
+            for (int p = 0; p < num_piles; p++) {
+                int val = tops[p];
+                if (val >= 11 && piles[val - 11] < 0) piles[val - 11] = p;
+            }
+            count = 3;
+        } else { // Start a new pile
+            int card = cards[top++];
+            tops[num_piles++] = card;
+            counts[card]++;
+            continue;
+        }
+
+        for (int i = 0; i < count && top < deck_size; i++) {
+            int card = cards[top++];
+            counts[tops[piles[i]]]--;
+            tops[piles[i]] = card;
+            counts[card]++;
+        }
+    }
+    return deck_size - top;
+}
+
+#undef ENGINE_NAME
+#undef ENGINE_PARAMS
+#undef ENGINE_DECK_SIZE
+#undef ENGINE_MAX_PILES
+#undef ENGINE_TARGET
+#undef ENGINE_JQK
+#undef ENGINE_PILE_CAP
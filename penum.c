@@ -0,0 +1,540 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "patience.h"
+#include "penum.h"
+
+/*
+ * Exact outcome distribution of a small deck by walking every distinct ordering.
+ * Cards of the same value are interchangeable, so the orderings are the multiset
+ * permutations of the deck: at each step the next card is one of the distinct values
+ * still undrawn, not one of the cards. The game is played along as the cards are
+ * chosen, so every prefix is played once and shared by all the orderings that start
+ * with it. As soon as a game is over the rest of its cards cannot matter, and all
+ * the orderings of them are counted at once: their number is the multinomial
+ * coefficient of what is left.
+ *
+ * Different prefixes often reach the same position, and then everything after is
+ * the same too. As psolve.c explains, the order in which covers are made never
+ * changes how a game ends, so between moves all that matters is how many piles show
+ * each value and how many cards of each value are still undrawn. With memoize on,
+ * each thread remembers the outcome counts of the positions it has walked, in a
+ * fixed-size cache that is emptied whenever it fills up. Positions are packed 4 bits
+ * per value, so decks with more than MEMO_MAX_COPIES cards of a value are walked
+ * without the memo (pile-top counts always fit: a position between moves has fewer
+ * than RULES_MAX_PILES piles).
+ *
+ * The walk is split into the distinct prefixes of a few cards, which are shared out
+ * between the threads as ranges. A thread whose range runs dry steals the back half
+ * of the largest range left, so the threads stay busy however uneven the prefixes.
+ */
+
+// A game being played one card at a time, the same way as play_cards plays it
+typedef struct gameState {
+    int tops[RULES_MAX_PILES];
+    int counts[14];             // Piles showing each value
+    int num_piles;
+    int drawn;                  // Cards drawn so far
+    int size;                   // Cards in the deck
+    int pending[2 * RULES_MAX_PILES]; // Piles the current move still covers; -1 starts a pile
+    int num_pending;
+    int next_pending;
+} gameState;
+
+static enumCount binomials[ENUM_MAX_CARDS + 1][ENUM_MAX_CARDS + 1];
+static pthread_once_t binomials_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Fills in Pascal's triangle up to ENUM_MAX_CARDS (the largest entry fits 64 bits).
+ */
+static void init_binomials(void) {
+    for (int n = 0; n <= ENUM_MAX_CARDS; n++) {
+        binomials[n][0] = binomials[n][n] = 1;
+        for (int k = 1; k < n; k++) binomials[n][k] = binomials[n - 1][k - 1] + binomials[n - 1][k];
+    }
+}
+
+/**
+ * Counts the distinct orderings of a multiset of cards: (sum of counts)! over the
+ * product of the counts' factorials, built up as a product of binomials.
+ * @param counts Cards of each value, indexed 1 to 13.
+ * @return The number of orderings (wraps if it exceeds 128 bits; enumerate_deck checks).
+ */
+enumCount multinomial(const int *counts) {
+    pthread_once(&binomials_once, init_binomials);
+    enumCount result = 1;
+    int n = 0;
+    for (int v = 1; v <= 13; v++) {
+        n += counts[v];
+        result *= binomials[n][counts[v]];
+    }
+    return result;
+}
+
+/**
+ * Writes a count in decimal.
+ * @param count The count.
+ * @param buffer Space for at least 40 characters.
+ */
+void format_count(enumCount count, char *buffer) {
+    char digits[40];
+    int len = 0;
+    do {
+        digits[len++] = (char)('0' + (int)(count % 10));
+        count /= 10;
+    } while (count);
+    for (int i = 0; i < len; i++) buffer[i] = digits[len - 1 - i];
+    buffer[len] = '\0';
+}
+
+/**
+ * Starts a game: its first two cards will each start a pile.
+ * @param s The game.
+ * @param size Cards in the deck.
+ */
+static void state_init(gameState *s, int size) {
+    memset(s, 0, sizeof(*s));
+    s->size = size;
+    s->pending[0] = s->pending[1] = -1;
+    s->num_pending = 2;
+}
+
+/**
+ * Gets a game ready for its next card: if the last move is done, decides the next
+ * one (scanning the piles as play_cards does), unless the game is over.
+ * @param s The game.
+ * @param rules The rules.
+ * @return 1 if the game wants another card, 0 if it is over.
+ */
+static int state_ready(gameState *s, const Rules *rules) {
+    if (s->drawn >= s->size) return 0;
+    if (s->next_pending < s->num_pending) return 1;
+    if (s->num_piles >= rules->max_piles) return 0;
+
+    int target = rules->target, count = 0;
+    int pairs = 0;
+    for (int v = 1; v <= 10 && !pairs; v++) {
+        int w = target - v;
+        if (w >= v && w <= 10) pairs = w == v ? s->counts[v] >= 2 : s->counts[v] && s->counts[w];
+    }
+    if (pairs) {
+        int seen[14] = {0}; // Pile index + 1 of the latest unmatched pile showing each value
+        for (int p = 0; p < s->num_piles; p++) {
+            int val = s->tops[p];
+            int needed = target - val;
+            if (val <= 10 && needed > 0 && needed <= 10 && seen[needed]) {
+                s->pending[count++] = seen[needed] - 1;
+                s->pending[count++] = p;
+                seen[needed] = 0;
+            } else {
+                seen[val] = p + 1;
+            }
+        }
+    } else if (rules->jqk && s->counts[11] && s->counts[12] && s->counts[13]) {
+        int *first = s->pending; // First pile showing J, Q and K
+        first[0] = first[1] = first[2] = -1;
+        for (int p = 0; p < s->num_piles; p++) {
+            int val = s->tops[p];
+            if (val >= 11 && first[val - 11] < 0) first[val - 11] = p;
+        }
+        count = 3;
+    } else {
+        s->pending[count++] = -1;
+    }
+    s->num_pending = count;
+    s->next_pending = 0;
+    return 1;
+}
+
+/**
+ * Draws a card into a game that is ready for it.
+ * @param s The game.
+ * @param card The card's value.
+ */
+static void state_place(gameState *s, int card) {
+    int p = s->pending[s->next_pending++];
+    if (p < 0) {
+        s->tops[s->num_piles++] = card;
+    } else {
+        s->counts[s->tops[p]]--;
+        s->tops[p] = card;
+    }
+    s->counts[card]++;
+    s->drawn++;
+}
+
+#define MEMO_BITS 20             // Log2 of the slots in a thread's memo
+#define MEMO_ARENA (1 << 23)     // Outcome counts a thread's memo can hold
+#define MEMO_MAX_COPIES 15       // Most cards of one value a memo key can hold
+
+// A thread's memo: positions (pile-top counts and undrawn counts, 4 bits per value)
+// and where their outcome counts (indexed by cards left, 0 to the cards undrawn) are
+typedef struct enumMemo {
+    uint64_t *keys;             // Two words per slot
+    long long *offsets;         // Into arena, or -1 for an empty slot
+    enumCount *arena;
+    long long used;             // Arena entries in use
+    long long filled;           // Slots in use
+} enumMemo;
+
+// One thread's share of the walk: its task range, results and context
+typedef struct enumWorker {
+    pthread_mutex_t lock;       // Guards next and end, which other threads steal from
+    long long next;             // Next task to take
+    long long end;              // One past the last task
+    struct enumWorker *all;     // Every worker, for stealing
+    int num_workers;
+    const Rules *rules;
+    const int *counts;          // The whole deck
+    const unsigned char *prefixes; // Task t is prefixes[t * depth ...]
+    int depth;
+    enumMemo *memo;             // NULL if memoize is off
+    enumResults results;
+} enumWorker;
+
+/**
+ * Makes an empty memo.
+ * @return The memo, or NULL if memory allocation fails.
+ */
+static enumMemo *memo_create(void) {
+    enumMemo *memo = calloc(1, sizeof(enumMemo));
+    if (memo) {
+        memo->keys = malloc(((size_t)2 << MEMO_BITS) * sizeof(uint64_t));
+        memo->offsets = malloc(((size_t)1 << MEMO_BITS) * sizeof(long long));
+        memo->arena = malloc((size_t)MEMO_ARENA * sizeof(enumCount));
+    }
+    if (!memo || !memo->keys || !memo->offsets || !memo->arena) {
+        perror("Memory allocation failed for enumeration memo");
+        if (memo) {
+            free(memo->keys);
+            free(memo->offsets);
+            free(memo->arena);
+            free(memo);
+        }
+        return NULL;
+    }
+    memset(memo->offsets, 0xFF, ((size_t)1 << MEMO_BITS) * sizeof(long long));
+    return memo;
+}
+
+/**
+ * Frees a memo.
+ * @param memo The memo (may be NULL).
+ */
+static void memo_free(enumMemo *memo) {
+    if (!memo) return;
+    free(memo->keys);
+    free(memo->offsets);
+    free(memo->arena);
+    free(memo);
+}
+
+/**
+ * Finds a position's slot in a memo, or the empty slot where it would go.
+ * @param memo The memo.
+ * @param tops Packed pile-top counts.
+ * @param undrawn Packed undrawn counts.
+ * @return The slot.
+ */
+static size_t memo_slot(const enumMemo *memo, uint64_t tops, uint64_t undrawn) {
+    size_t mask = ((size_t)1 << MEMO_BITS) - 1;
+    size_t slot = (size_t)((tops * 0x9E3779B97F4A7C15ULL ^ undrawn * 0xC2B2AE3D27D4EB4FULL) >> 40) & mask;
+    while (memo->offsets[slot] >= 0 &&
+           (memo->keys[2 * slot] != tops || memo->keys[2 * slot + 1] != undrawn)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * Remembers a position's outcome counts, first emptying the memo if it is full.
+ * @param memo The memo.
+ * @param tops Packed pile-top counts.
+ * @param undrawn Packed undrawn counts.
+ * @param left Outcome counts, indexed by cards left.
+ * @param length Number of outcome counts (cards undrawn + 1).
+ */
+static void memo_store(enumMemo *memo, uint64_t tops, uint64_t undrawn, const enumCount *left, int length) {
+    if (memo->used + length > MEMO_ARENA || memo->filled >= (3LL << MEMO_BITS) / 4) {
+        memset(memo->offsets, 0xFF, ((size_t)1 << MEMO_BITS) * sizeof(long long));
+        memo->used = memo->filled = 0;
+    }
+    size_t slot = memo_slot(memo, tops, undrawn);
+    memo->keys[2 * slot] = tops;
+    memo->keys[2 * slot + 1] = undrawn;
+    memo->offsets[slot] = memo->used;
+    memcpy(memo->arena + memo->used, left, length * sizeof(enumCount));
+    memo->used += length;
+    memo->filled++;
+}
+
+/**
+ * Walks every ordering of the cards left, playing the game along, and adds up how
+ * many of them leave each number of cards.
+ * @param w The worker (for the rules, memo and statistics).
+ * @param s The game so far (gets readied for its next card).
+ * @param remaining Cards of each value still undrawn (restored on return).
+ * @param left Outcome counts to add to, indexed by cards left.
+ */
+static void walk(enumWorker *w, gameState *s, int *remaining, enumCount *left) {
+    int between_moves = s->next_pending >= s->num_pending;
+    if (!state_ready(s, w->rules)) {
+        left[s->size - s->drawn] += multinomial(remaining);
+        return;
+    }
+
+    enumCount counts[ENUM_MAX_CARDS + 1], *dest = left;
+    uint64_t tops = 0, undrawn = 0;
+    int length = s->size - s->drawn + 1;
+    if (w->memo && between_moves) {
+        for (int v = 1; v <= 13; v++) {
+            tops |= (uint64_t)s->counts[v] << (4 * (v - 1));
+            undrawn |= (uint64_t)remaining[v] << (4 * (v - 1));
+        }
+        size_t slot = memo_slot(w->memo, tops, undrawn);
+        if (w->memo->offsets[slot] >= 0) {
+            const enumCount *known = w->memo->arena + w->memo->offsets[slot];
+            for (int k = 0; k < length; k++) left[k] += known[k];
+            w->results.memo_hits++;
+            return;
+        }
+        memset(counts, 0, length * sizeof(enumCount));
+        dest = counts;
+    }
+
+    for (int v = 1; v <= 13; v++) {
+        if (!remaining[v]) continue;
+        gameState child = *s;
+        state_place(&child, v);
+        w->results.nodes++;
+        remaining[v]--;
+        walk(w, &child, remaining, dest);
+        remaining[v]++;
+    }
+
+    if (dest != left) {
+        memo_store(w->memo, tops, undrawn, counts, length);
+        for (int k = 0; k < length; k++) left[k] += counts[k];
+    }
+}
+
+/**
+ * Lists the distinct prefixes of the deck, depth cards long, that leave a game still
+ * in progress; games that end sooner are counted straight into the results.
+ * @param s The game so far.
+ * @param remaining Cards of each value still undrawn.
+ * @param prefix The cards of the current prefix.
+ * @param depth Prefix length wanted.
+ * @param rules The rules.
+ * @param list Growing list of prefixes (depth bytes each).
+ * @param count Prefixes in the list.
+ * @param capacity Prefixes the list has room for.
+ * @param results Receives the games that end within the prefix.
+ * @return 0 on success, -1 if memory allocation fails.
+ */
+static int list_prefixes(gameState *s, int *remaining, unsigned char *prefix, int depth,
+                         const Rules *rules, unsigned char **list, long long *count,
+                         long long *capacity, enumResults *results) {
+    if (!state_ready(s, rules)) {
+        results->left[s->size - s->drawn] += multinomial(remaining);
+        return 0;
+    }
+    if (s->drawn == depth) {
+        if (*count == *capacity) {
+            long long grown = *capacity ? 2 * *capacity : 1024;
+            unsigned char *bigger = realloc(*list, (size_t)grown * depth);
+            if (!bigger) {
+                perror("Memory allocation failed for enumeration tasks");
+                return -1;
+            }
+            *list = bigger;
+            *capacity = grown;
+        }
+        memcpy(*list + (size_t)*count * depth, prefix, depth);
+        (*count)++;
+        return 0;
+    }
+    for (int v = 1; v <= 13; v++) {
+        if (!remaining[v]) continue;
+        gameState child = *s;
+        state_place(&child, v);
+        prefix[s->drawn] = (unsigned char)v;
+        remaining[v]--;
+        int status = list_prefixes(&child, remaining, prefix, depth, rules, list, count, capacity, results);
+        remaining[v]++;
+        if (status != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * Takes the next task for a worker: from its own range if it has any left, otherwise
+ * by stealing the back half of the largest range another worker has.
+ * @param w The worker.
+ * @return The task, or -1 when no work is left anywhere.
+ */
+static long long next_task(enumWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    long long task = w->next < w->end ? w->next++ : -1;
+    pthread_mutex_unlock(&w->lock);
+    if (task >= 0) return task;
+
+    for (;;) {
+        // Pick the victim with the most left (unlocked reads are only a hint)
+        enumWorker *victim = NULL;
+        long long most = 0;
+        for (int i = 0; i < w->num_workers; i++) {
+            enumWorker *other = &w->all[i];
+            if (other == w) continue;
+            long long left = other->end - other->next;
+            if (left > most) {
+                most = left;
+                victim = other;
+            }
+        }
+        if (!victim) return -1;
+
+        pthread_mutex_lock(&victim->lock);
+        long long first = 0, end = 0;
+        if (victim->next < victim->end) {
+            first = victim->next + (victim->end - victim->next) / 2;
+            end = victim->end;
+            victim->end = first;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (first == end) continue; // Emptied before we got there: look again
+
+        pthread_mutex_lock(&w->lock);
+        w->next = first + 1;
+        w->end = end;
+        w->results.steals++;
+        pthread_mutex_unlock(&w->lock);
+        return first;
+    }
+}
+
+/**
+ * Runs tasks until there are none left anywhere: replays each prefix, then walks
+ * every ordering that follows it.
+ * @param arg Pointer to the thread's enumWorker.
+ * @return NULL.
+ */
+static void *enum_worker(void *arg) {
+    enumWorker *w = arg;
+    int size = 0;
+    for (int v = 1; v <= 13; v++) size += w->counts[v];
+    for (long long task; (task = next_task(w)) >= 0;) {
+        int remaining[14];
+        memcpy(remaining, w->counts, sizeof(remaining));
+        gameState s;
+        state_init(&s, size);
+        const unsigned char *prefix = w->prefixes + (size_t)task * w->depth;
+        for (int i = 0; i < w->depth; i++) {
+            state_ready(&s, w->rules);
+            state_place(&s, prefix[i]);
+            remaining[prefix[i]]--;
+        }
+        walk(w, &s, remaining, w->results.left);
+        w->results.tasks++;
+    }
+    return NULL;
+}
+
+/**
+ * Finds the exact distribution of cards left over every ordering of a small deck.
+ * @param counts Cards of each value in the deck, indexed 1 to 13 (index 0 unused).
+ * @param rules The rules (max_piles at most RULES_MAX_PILES).
+ * @param num_threads Number of threads to use (0 means one per CPU).
+ * @param split_depth Length of the prefixes the work is split into (smaller for a
+ *                    quick start, larger for finer-grained sharing).
+ * @param memoize 1 to remember the outcomes of positions already walked (ignored if
+ *                the deck has more than MEMO_MAX_COPIES cards of a value).
+ * @param results Receives the distribution.
+ * @return 0 on success, -1 if the deck is too big or memory allocation fails.
+ */
+int enumerate_deck(const int *counts, const Rules *rules, int num_threads, int split_depth,
+                   int memoize, enumResults *results) {
+    memset(results, 0, sizeof(*results));
+    int size = 0;
+    long double orderings = 1; // Checked in floating point first, for overflow
+    for (int v = 1; v <= 13; v++) {
+        for (int i = 1; i <= counts[v]; i++) orderings *= (long double)(size + i) / i;
+        size += counts[v];
+    }
+    if (size < 2 || size > ENUM_MAX_CARDS || orderings >= 3.0e38L) {
+        fprintf(stderr, "Deck of %d cards has too many orderings to count exactly\n", size);
+        return -1;
+    }
+    for (int v = 1; v <= 13 && memoize; v++) {
+        if (counts[v] > MEMO_MAX_COPIES) {
+            fprintf(stderr, "More than %d cards of value %d: walking without the memo\n", MEMO_MAX_COPIES, v);
+            memoize = 0;
+        }
+    }
+    if (split_depth > size) split_depth = size;
+    if (split_depth < 2) split_depth = 2;
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    results->total = multinomial(counts);
+
+    // Share out the prefixes; games over within them are counted here
+    unsigned char *prefixes = NULL, prefix[ENUM_MAX_CARDS];
+    long long num_tasks = 0, capacity = 0;
+    int remaining[14];
+    memcpy(remaining, counts, sizeof(remaining));
+    gameState s;
+    state_init(&s, size);
+    if (list_prefixes(&s, remaining, prefix, split_depth, rules, &prefixes, &num_tasks, &capacity,
+                      results) != 0) {
+        free(prefixes);
+        return -1;
+    }
+
+    enumWorker *workers = calloc(num_threads, sizeof(enumWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!workers || !threads) {
+        perror("Memory allocation failed for enumeration threads");
+        free(workers);
+        free(threads);
+        free(prefixes);
+        return -1;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        pthread_mutex_init(&workers[t].lock, NULL);
+        workers[t].next = num_tasks * t / num_threads;
+        workers[t].end = num_tasks * (t + 1) / num_threads;
+        workers[t].all = workers;
+        workers[t].num_workers = num_threads;
+        workers[t].rules = rules;
+        workers[t].counts = counts;
+        workers[t].prefixes = prefixes;
+        workers[t].depth = split_depth;
+        if (memoize && !(workers[t].memo = memo_create())) exit(1);
+    }
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, enum_worker, &workers[t]) != 0) {
+            perror("Failed to start enumeration thread");
+            exit(1);
+        }
+    }
+    enum_worker(&workers[0]); // The main thread works too
+    for (int t = 1; t < num_threads; t++) pthread_join(threads[t], NULL);
+
+    for (int t = 0; t < num_threads; t++) {
+        for (int k = 0; k <= ENUM_MAX_CARDS; k++) results->left[k] += workers[t].results.left[k];
+        results->nodes += workers[t].results.nodes;
+        results->tasks += workers[t].results.tasks;
+        results->steals += workers[t].results.steals;
+        results->memo_hits += workers[t].results.memo_hits;
+        memo_free(workers[t].memo);
+        pthread_mutex_destroy(&workers[t].lock);
+    }
+    free(workers);
+    free(threads);
+    free(prefixes);
+    return 0;
+}
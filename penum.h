@@ -0,0 +1,26 @@
+#ifndef PENUM_H
+#define PENUM_H
+
+#include "patience.h"
+
+#define ENUM_MAX_CARDS 52
+
+// Exact number of orderings (of a multiset deck, up to 2^128 - 1)
+typedef unsigned __int128 enumCount;
+
+// Exact outcome distribution of a reduced deck, from enumerate_deck
+typedef struct enumResults {
+    enumCount left[ENUM_MAX_CARDS + 1]; // Orderings leaving each number of cards
+    enumCount total;                    // All distinct orderings of the deck
+    long long nodes;                    // Cards placed while walking the orderings
+    long long tasks;                    // Prefixes handed out to threads
+    long long steals;                   // Times a thread took work from another
+    long long memo_hits;                // Positions whose outcomes were already known
+} enumResults;
+
+enumCount multinomial(const int *counts);
+void format_count(enumCount count, char *buffer);
+int enumerate_deck(const int *counts, const Rules *rules, int num_threads, int split_depth,
+                   int memoize, enumResults *results);
+
+#endif
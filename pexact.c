@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "penum.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing the enumeration.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Steps an array to the next ordering in lexicographic order, skipping repeats.
+ * @param x The array.
+ * @param n Its length.
+ * @return 1 if there was a next ordering, 0 if x was the last (and is now sorted).
+ */
+static int next_ordering(int *x, int n) {
+    int i = n - 2;
+    while (i >= 0 && x[i] >= x[i + 1]) i--;
+    int found = i >= 0;
+    if (found) {
+        int j = n - 1;
+        while (x[j] <= x[i]) j--;
+        int tmp = x[i]; x[i] = x[j]; x[j] = tmp;
+    }
+    for (int a = i + 1, b = n - 1; a < b; a++, b--) {
+        int tmp = x[a]; x[a] = x[b]; x[b] = tmp;
+    }
+    return found;
+}
+
+/**
+ * Plays every distinct ordering of the deck in full with play_cards, for checking
+ * the enumeration on decks small enough.
+ * @param cards The deck, sorted.
+ * @param size Number of cards.
+ * @param rules The rules.
+ * @param left Array of size + 1 to receive the orderings leaving each number of cards.
+ */
+static void brute_force(int *cards, int size, const Rules *rules, enumCount *left) {
+    do {
+        left[play_cards(cards, size, rules)]++;
+    } while (next_ordering(cards, size));
+}
+
+/**
+ * Works out the exact distribution of cards left for a small deck (by default one
+ * suit, 13 cards) over every ordering of it, then checks it against a sample from
+ * play_cards, and optionally against playing every ordering in full.
+ */
+int main(int argc, char *argv[]) {
+    int values[13], num_values = 13, copies = 1;
+    for (int v = 0; v < 13; v++) values[v] = v + 1;
+    Rules rules;
+    default_rules(&rules);
+    int num_threads = 0, depth = 4, brute = 0, memoize = 1;
+    long long samples = 1000000;
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "v:c:T:P:Jt:d:m:s:xn")) != -1) {
+        char *end = NULL;
+        if (opt == 'v') {
+            // Comma-separated values, each 1 to 13 and not repeated
+            num_values = 0;
+            for (const char *text = optarg; num_values < 13; text = end + 1) {
+                long value = strtol(text, &end, 10);
+                if (end == text || value < 1 || value > 13) break;
+                values[num_values++] = (int)value;
+                if (*end != ',') break;
+            }
+            for (int i = 0; i < num_values; i++) {
+                for (int j = 0; j < i; j++) if (values[i] == values[j]) num_values = -1;
+                if (num_values < 0) break;
+            }
+            if (num_values < 1) break;
+        }
+        else if (opt == 'c') copies = (int)strtol(optarg, &end, 10);
+        else if (opt == 'T') rules.target = (int)strtol(optarg, &end, 10);
+        else if (opt == 'P') rules.max_piles = (int)strtol(optarg, &end, 10);
+        else if (opt == 'J') rules.jqk = 0;
+        else if (opt == 't') num_threads = (int)strtol(optarg, &end, 10);
+        else if (opt == 'd') depth = (int)strtol(optarg, &end, 10);
+        else if (opt == 'm') samples = strtoll(optarg, &end, 10);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10);
+        else if (opt == 'x') brute = 1;
+        else if (opt == 'n') memoize = 0;
+        else break;
+        if (end && *end != '\0') break; // Trailing junk
+    }
+    int size = num_values * copies;
+    if (opt != -1 || optind != argc || copies < 1 || size > ENUM_MAX_CARDS || size < 2 ||
+        rules.target < 2 || rules.target > 20 || rules.max_piles < 2 ||
+        rules.max_piles > RULES_MAX_PILES || samples < 0) {
+        fprintf(stderr, "Usage: %s [-v values] [-c copies] [-T target] [-P piles] [-J] [-t threads]\n", argv[0]);
+        fprintf(stderr, "          [-d split depth] [-m samples] [-s seed] [-x] [-n]\n");
+        fprintf(stderr, "  -v  card values in the deck, e.g. 1,2,3,11,12,13 (default 1-13: one suit)\n");
+        fprintf(stderr, "  -c  copies of each value (default 1)\n");
+        fprintf(stderr, "  -T  pair target (default 11)\n");
+        fprintf(stderr, "  -P  pile limit, 2 to %d (default 9)\n", RULES_MAX_PILES);
+        fprintf(stderr, "  -J  never cover J, Q, K\n");
+        fprintf(stderr, "  -t  threads (default 0 = one per CPU)\n");
+        fprintf(stderr, "  -d  prefix length the work is split by (default 4)\n");
+        fprintf(stderr, "  -m  games to sample with play_cards for comparison (default 1000000, 0 for none)\n");
+        fprintf(stderr, "  -s  seed for the sample (default 1)\n");
+        fprintf(stderr, "  -x  also play every ordering in full and compare (small decks only)\n");
+        fprintf(stderr, "  -n  don't remember positions already walked (much slower)\n");
+        return 1;
+    }
+
+    int counts[14] = {0}, cards[ENUM_MAX_CARDS];
+    for (int i = 0; i < num_values; i++) counts[values[i]] = copies;
+    for (int v = 1, i = 0; v <= 13; v++) {
+        for (int c = 0; c < counts[v]; c++) cards[i++] = v;
+    }
+
+    enumResults results;
+    double t0 = now();
+    if (enumerate_deck(counts, &rules, num_threads, depth, memoize, &results) != 0) return 1;
+    double elapsed = now() - t0;
+
+    enumCount sum = 0;
+    for (int k = 0; k <= size; k++) sum += results.left[k];
+    char total[40];
+    format_count(results.total, total);
+    printf("Exact outcomes of a %d-card deck (target %d, %d piles, J, Q, K %s): %s orderings\n",
+           size, rules.target, rules.max_piles, rules.jqk ? "on" : "off", total);
+    printf("%.3f s, %lld cards placed, %lld positions remembered, %lld tasks, %lld steals%s\n",
+           elapsed, results.nodes, results.memo_hits, results.tasks, results.steals,
+           sum == results.total ? "" : "; COUNTS DO NOT ADD UP");
+
+    // A sample from the ordinary engine, to compare
+    long long *sampled = calloc(size + 1, sizeof(long long));
+    if (!sampled) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    Rng rng;
+    rng_seed(&rng, seed);
+    int deck[ENUM_MAX_CARDS];
+    for (long long i = 0; i < samples; i++) {
+        memcpy(deck, cards, size * sizeof(int));
+        shuffle_fy(deck, size, &rng);
+        sampled[play_cards(deck, size, &rules)]++;
+    }
+
+    printf("%-10s %40s %12s %12s %8s\n", "cards left", "orderings", "exact %", "sampled %", "z");
+    double max_z = 0;
+    for (int k = 0; k <= size; k++) {
+        if (!results.left[k] && !sampled[k]) continue;
+        char count[40];
+        format_count(results.left[k], count);
+        double p = (double)results.left[k] / (double)results.total;
+        double z = 0;
+        if (samples && p > 0 && p < 1) z = (sampled[k] - samples * p) / sqrt(samples * p * (1 - p));
+        else if (samples && sampled[k] != (long long)(samples * p)) z = INFINITY; // Impossible outcome seen
+        if (fabs(z) > max_z) max_z = fabs(z);
+        printf("%-10d %40s %12.6f %12.6f %8.2f\n", k, count, 100 * p,
+               samples ? 100.0 * sampled[k] / samples : 0.0, z);
+    }
+    if (samples) printf("largest |z| of the sample against the exact values: %.2f\n", max_z);
+    free(sampled);
+
+    int status = sum != results.total;
+    if (brute) {
+        enumCount *left = calloc(size + 1, sizeof(enumCount));
+        if (!left) {
+            perror("Memory allocation failed");
+            return 1;
+        }
+        t0 = now();
+        brute_force(cards, size, &rules, left);
+        int same = memcmp(left, results.left, (size + 1) * sizeof(enumCount)) == 0;
+        printf("playing every ordering in full: %.3f s, %s\n", now() - t0,
+               same ? "identical" : "DIFFERENT");
+        status |= !same;
+        free(left);
+    }
+    return status;
+}
@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "anagram.h"
+#include "anaindex.h"
+#include "phrase.h"
+
+#define TIME_CHECK_INTERVAL 4096 // Search states between looks at the clock
+
+/*
+ * A letter set the search has already tried and found no phrase for. Later
+ * candidates and fewer words left only shrink the choices, so the same letters are
+ * also a dead end from any start at or after this one, at any depth at or below it.
+ */
+typedef struct memoSlot {
+    anagramSig remaining;     // Letters still to be used
+    uint32_t start;           // First candidate position that was allowed, plus one (0 for an empty slot)
+    uint32_t depth;           // Words already placed
+} memoSlot;
+
+// Everything one solve_phrase call carries through the recursion
+typedef struct phraseSearch {
+    const anaIndex *index;
+    const phraseOptions *options;
+    const uint32_t *candidates; // Groups that fit the whole phrase, shortest first
+    int num_candidates;
+    uint32_t *lists;          // One filtered candidate list per depth (positions in candidates)
+    uint32_t *path;           // Groups placed so far
+    int max_depth;            // Most words a phrase can have
+    int min_length;           // Shortest word allowed
+    memoSlot *memo;           // Open-addressing set of dead ends
+    size_t memo_capacity;     // Slots in memo (a power of two)
+    size_t memo_count;        // Dead ends stored
+    phraseResults *results;
+    double deadline;          // Monotonic time to give up at (0 for none)
+    int stopped;              // Set when a limit is hit or memory runs out
+    int failed;               // Set when memory runs out
+} phraseSearch;
+
+/**
+ * Returns the current monotonic time in seconds, for the search time limit.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Fills in the default search limits: words of 3+ letters, at most 4 of them,
+ * 100 phrases and 2 seconds, with memoization off. Under these limits the memo
+ * costs more than it saves (see anabench phrase); turn it on for unlimited searches.
+ * @param options The options to fill in.
+ */
+void default_phrase_options(phraseOptions *options) {
+    options->min_word_length = 3;
+    options->max_words = 4;
+    options->max_results = 100;
+    options->max_seconds = 2.0;
+    options->memoize = 0;
+}
+
+/**
+ * Finds the memo slot for a set of remaining letters, or the empty slot where it would go.
+ * @param s The search.
+ * @param remaining Letters still to be used.
+ * @return Pointer to the matching or empty slot.
+ */
+static memoSlot *memo_probe(phraseSearch *s, anagramSig remaining) {
+    size_t mask = s->memo_capacity - 1;
+    for (size_t slot = hash_sig(remaining) & mask;; slot = (slot + 1) & mask) {
+        memoSlot *m = &s->memo[slot];
+        if (!m->start || sig_equal(m->remaining, remaining)) return m;
+    }
+}
+
+/**
+ * Checks whether a state is known to lead nowhere.
+ * @param s The search.
+ * @param remaining Letters still to be used.
+ * @param start Position of the first allowed candidate.
+ * @param depth Words already placed.
+ * @return 1 if a dead end covering this state has been recorded, 0 otherwise.
+ */
+static int memo_is_dead(phraseSearch *s, anagramSig remaining, uint32_t start, uint32_t depth) {
+    memoSlot *m = memo_probe(s, remaining);
+    return m->start && start + 1 >= m->start && depth >= m->depth;
+}
+
+/**
+ * Records a state that leads to no phrase, doubling the memo when it gets half full.
+ * One dead end is kept per letter set: a new one replaces the old if it covers it.
+ * @param s The search.
+ * @param remaining Letters still to be used.
+ * @param start Position of the first allowed candidate.
+ * @param depth Words already placed.
+ */
+static void memo_insert(phraseSearch *s, anagramSig remaining, uint32_t start, uint32_t depth) {
+    if (2 * (s->memo_count + 1) > s->memo_capacity) {
+        size_t old_capacity = s->memo_capacity;
+        memoSlot *old = s->memo;
+        s->memo = calloc(old_capacity * 2, sizeof(memoSlot));
+        if (!s->memo) {
+            // Not fatal: keep searching with the memo we have
+            s->memo = old;
+            return;
+        }
+        s->memo_capacity = old_capacity * 2;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].start) *memo_probe(s, old[i].remaining) = old[i];
+        }
+        free(old);
+    }
+    memoSlot *m = memo_probe(s, remaining);
+    if (!m->start) {
+        s->memo_count++;
+    } else if (start + 1 > m->start || depth > m->depth) {
+        return; // The stored dead end covers at least as much
+    }
+    m->remaining = remaining;
+    m->start = start + 1;
+    m->depth = depth;
+}
+
+/**
+ * Appends the current path to the results as a new phrase.
+ * @param s The search.
+ * @param depth Number of groups in the path.
+ */
+static void record_phrase(phraseSearch *s, int depth) {
+    phraseResults *r = s->results;
+    int used = r->starts[r->count];
+    uint32_t *groups = realloc(r->groups, (used + depth) * sizeof(uint32_t));
+    int *starts = groups ? realloc(r->starts, (r->count + 2) * sizeof(int)) : NULL;
+    if (groups) r->groups = groups;
+    if (starts) r->starts = starts;
+    if (!groups || !starts) {
+        perror("Memory allocation failed for phrases");
+        s->failed = s->stopped = 1;
+        return;
+    }
+    memcpy(r->groups + used, s->path, depth * sizeof(uint32_t));
+    r->count++;
+    r->starts[r->count] = used + depth;
+    if (s->options->max_results > 0 && r->count >= s->options->max_results) {
+        r->truncated = 1;
+        s->stopped = 1;
+    }
+}
+
+/**
+ * Depth-first search for phrases using up exactly the remaining letters.
+ * Words are placed in candidate order (never going back to an earlier candidate), so
+ * each multiset of words turns up once. The parent's list only holds candidates
+ * that fit the parent's letters, and is cut down again to those that fit what's
+ * left here: sorted shortest first, the scan stops at the first one too long. If the
+ * survivors between them lack some letter that's still needed, nothing can finish.
+ * States that come to nothing are remembered so other word orders skip them.
+ * @param s The search.
+ * @param remaining Letters still to be used.
+ * @param list Candidate positions allowed here, ascending.
+ * @param list_length Number of positions in list.
+ * @param depth Words already placed.
+ * @return Number of phrases found below this state.
+ */
+static int search(phraseSearch *s, anagramSig remaining, const uint32_t *list, int list_length, int depth) {
+    int letters = sig_length(remaining);
+    if (letters == 0) {
+        record_phrase(s, depth);
+        return 1;
+    }
+    if (depth == s->max_depth) return 0;
+
+    s->results->nodes++;
+    if (s->deadline > 0 && s->results->nodes % TIME_CHECK_INTERVAL == 0 && now() > s->deadline) {
+        s->results->truncated = 1;
+        s->stopped = 1;
+        return 0;
+    }
+
+    // Keep the candidates that still fit
+    const anaIndex *index = s->index;
+    uint32_t have = sig_letter_mask(remaining), covered = 0;
+    uint32_t *fitting = s->lists + (size_t)depth * s->num_candidates;
+    int num_fitting = 0;
+    for (int i = 0; i < list_length; i++) {
+        uint32_t g = s->candidates[list[i]];
+        if (sig_length(index->groups[g].sig) > letters) break;
+        if (index->masks[g] & ~have) continue;
+        if (!sig_fits(index->groups[g].sig, remaining)) continue;
+        fitting[num_fitting++] = list[i];
+        covered |= index->masks[g];
+    }
+    if (have & ~covered) return 0;
+
+    int found = 0;
+    for (int i = 0; i < num_fitting && !s->stopped; i++) {
+        uint32_t g = s->candidates[fitting[i]];
+        anagramSig rest = sig_subtract(remaining, index->groups[g].sig);
+        // A leftover too short for two words is settled by one scan of the list,
+        // which is cheaper than remembering it
+        int memoize = s->options->memoize && sig_length(rest) >= 2 * s->min_length;
+        if (memoize && memo_is_dead(s, rest, fitting[i], depth + 1)) {
+            s->results->memo_hits++;
+            continue;
+        }
+        s->path[depth] = g;
+        int below = search(s, rest, fitting + i, num_fitting - i, depth + 1);
+        if (below == 0 && !s->stopped && memoize) memo_insert(s, rest, fitting[i], depth + 1);
+        found += below;
+    }
+    return found;
+}
+
+/**
+ * Finds phrases whose words use exactly the letters of a given phrase, e.g.,
+ * "dormitory" gives "dirty room". Case, spaces and punctuation are ignored.
+ * The words come from the index's groups; only groups that fit the whole phrase
+ * (found with ana_sub_anagrams) are ever considered.
+ * @param index The index to take words from.
+ * @param phrase The phrase to rearrange.
+ * @param options Search limits (see default_phrase_options).
+ * @return The phrases found (check truncated for whether the search finished, and
+ *         saturated for a phrase with more of a letter than signatures can count),
+ *         or NULL if memory allocation fails.
+ */
+phraseResults *solve_phrase(const anaIndex *index, const char *phrase, const phraseOptions *options) {
+    phraseSearch s = {0};
+    s.index = index;
+    s.options = options;
+    s.results = calloc(1, sizeof(phraseResults));
+    uint32_t *candidates = malloc((index->header->num_groups + 1) * sizeof(uint32_t));
+    if (!s.results || !candidates || !(s.results->starts = calloc(1, sizeof(int)))) {
+        perror("Memory allocation failed");
+        free(candidates);
+        free_phrase_results(s.results);
+        return NULL;
+    }
+
+    anagramSig letters = word_signature(phrase);
+    if (!sig_exact(letters)) { // The letter counts are wrong, so any answer would be too
+        s.results->saturated = 1;
+        free(candidates);
+        return s.results;
+    }
+    int min_length = options->min_word_length > 0 ? options->min_word_length : 1;
+    s.candidates = candidates;
+    s.min_length = min_length;
+    s.num_candidates = ana_sub_anagrams(index, letters, min_length, candidates, index->header->num_groups);
+    s.max_depth = sig_length(letters) / min_length;
+    if (options->max_words > 0 && options->max_words < s.max_depth) s.max_depth = options->max_words;
+    if (s.num_candidates == 0 || s.max_depth == 0) {
+        free(candidates);
+        return s.results;
+    }
+
+    s.lists = malloc(((size_t)s.max_depth + 1) * s.num_candidates * sizeof(uint32_t));
+    s.path = malloc(((size_t)s.max_depth + 1) * sizeof(uint32_t));
+    s.memo_capacity = 1024;
+    s.memo = calloc(s.memo_capacity, sizeof(memoSlot));
+    if (!s.lists || !s.path || !s.memo) {
+        perror("Memory allocation failed");
+        s.failed = 1;
+    } else {
+        // The root list is every candidate, and the last depth's slice holds it
+        uint32_t *all = s.lists + (size_t)s.max_depth * s.num_candidates;
+        for (int i = 0; i < s.num_candidates; i++) all[i] = i;
+        s.deadline = options->max_seconds > 0 ? now() + options->max_seconds : 0;
+        search(&s, letters, all, s.num_candidates, 0);
+    }
+
+    free(candidates);
+    free(s.lists);
+    free(s.path);
+    free(s.memo);
+    if (s.failed) {
+        free_phrase_results(s.results);
+        return NULL;
+    }
+    return s.results;
+}
+
+/**
+ * Frees the phrases returned by solve_phrase.
+ * @param results The phrases to free (may be NULL).
+ */
+void free_phrase_results(phraseResults *results) {
+    if (!results) return;
+    free(results->groups);
+    free(results->starts);
+    free(results);
+}
+
+/**
+ * Prints one phrase, words separated by spaces. Where a group holds several words,
+ * they are all shown as alternatives joined by '/', e.g., "dirty moor/room".
+ * @param fptr Stream to print to.
+ * @param index The index the phrase's groups come from.
+ * @param results The phrases.
+ * @param r Which phrase to print.
+ */
+void print_phrase(FILE *fptr, const anaIndex *index, const phraseResults *results, int r) {
+    for (int p = results->starts[r]; p < results->starts[r + 1]; p++) {
+        const anaGroup *group = &index->groups[results->groups[p]];
+        if (p > results->starts[r]) fputc(' ', fptr);
+        for (uint32_t i = 0; i < group->word_count; i++) {
+            if (i > 0) fputc('/', fptr);
+            fputs(ana_word(index, group, i), fptr);
+        }
+    }
+}
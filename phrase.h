@@ -0,0 +1,35 @@
+#ifndef PHRASE_H
+#define PHRASE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "anaindex.h"
+
+typedef struct phraseOptions {
+    int min_word_length;      // Shortest word a phrase may use
+    int max_words;            // Most words in a phrase (0 for no limit)
+    int max_results;          // Stop after this many phrases (0 for no limit)
+    double max_seconds;       // Stop searching after this long (0 for no limit)
+    int memoize;              // 1 to remember letter sets that lead nowhere
+} phraseOptions;
+
+/*
+ * Phrases found by solve_phrase. Each phrase is a run of group indices into the
+ * index, shortest word first; every word of a group fits in that position.
+ */
+typedef struct phraseResults {
+    uint32_t *groups;         // Group indices of all phrases, one phrase after another
+    int *starts;              // Phrase r is groups[starts[r]] to groups[starts[r + 1] - 1]
+    int count;                // Number of phrases
+    int truncated;            // 1 if the result or time limit cut the search short
+    int saturated;            // 1 if the phrase has more than 15 of a letter (not searched)
+    long long nodes;          // Search states expanded
+    long long memo_hits;      // States skipped because they were known dead ends
+} phraseResults;
+
+void default_phrase_options(phraseOptions *options);
+phraseResults *solve_phrase(const anaIndex *index, const char *phrase, const phraseOptions *options);
+void free_phrase_results(phraseResults *results);
+void print_phrase(FILE *fptr, const anaIndex *index, const phraseResults *results, int r);
+
+#endif
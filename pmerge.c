@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pshard.h"
+
+/**
+ * Orders shards by their first game, for qsort.
+ */
+static int compare_first(const void *a, const void *b) {
+    long long x = ((const Shard *)a)->first, y = ((const Shard *)b)->first;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Combines the shard files of a run (from pstatistics -k) into one outcome
+ * histogram. The shards must share a seed, be finished and not overlap. If they
+ * cover games 0 to n - 1 with no gaps, the histogram is exactly the one a single
+ * pstatistics -n n run with that seed gives; gaps are allowed but reported.
+ */
+int main(int argc, char *argv[]) {
+    const char *output_path = "-";
+    int format = FORMAT_TEXT;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:f:")) != -1) {
+        if (opt == 'o') output_path = optarg;
+        else if (opt == 'f') {
+            if (strcmp(optarg, "text") == 0) format = FORMAT_TEXT;
+            else if (strcmp(optarg, "csv") == 0) format = FORMAT_CSV;
+            else if (strcmp(optarg, "json") == 0) format = FORMAT_JSON;
+            else break;
+        } else break;
+    }
+    if (opt != -1 || optind == argc) {
+        fprintf(stderr, "Usage: %s [-o file | -] [-f text|csv|json] shard-file...\n", argv[0]);
+        fprintf(stderr, "  -o  output file (default - for stdout)\n");
+        fprintf(stderr, "  -f  output format (default text)\n");
+        return 1;
+    }
+
+    int num_shards = argc - optind;
+    Shard *shards = malloc(num_shards * sizeof(Shard));
+    if (!shards) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    for (int i = 0; i < num_shards; i++) {
+        const char *path = argv[optind + i];
+        int found = shard_read(path, &shards[i]);
+        if (found == 1) fprintf(stderr, "%s: no such file\n", path);
+        else if (found == 0 && shards[i].done < shards[i].games) {
+            fprintf(stderr, "%s is unfinished: %lld of %lld games done (resume it with pstatistics -k)\n",
+                    path, shards[i].done, shards[i].games);
+            found = -1;
+        } else if (found == 0 && shards[i].seed != shards[0].seed) {
+            fprintf(stderr, "%s has seed %llu, but %s has seed %llu\n", path,
+                    (unsigned long long)shards[i].seed, argv[optind], (unsigned long long)shards[0].seed);
+            found = -1;
+        }
+        if (found != 0) {
+            free(shards);
+            return 1;
+        }
+    }
+
+    // Sorted by first game, an overlap shows up between neighbours
+    qsort(shards, num_shards, sizeof(Shard), compare_first);
+    long long matches[53] = {0}, n = 0, gaps = 0;
+    for (int i = 0; i < num_shards; i++) {
+        long long expected = i ? shards[i - 1].first + shards[i - 1].games : 0;
+        if (shards[i].first < expected) {
+            fprintf(stderr, "Shards overlap: games %lld to %lld are in two files\n",
+                    shards[i].first, expected - 1);
+            free(shards);
+            return 1;
+        }
+        if (shards[i].first > expected) {
+            fprintf(stderr, "Warning: games %lld to %lld are in no shard\n", expected, shards[i].first - 1);
+            gaps += shards[i].first - expected;
+        }
+        for (int k = 0; k < 53; k++) matches[k] += shards[i].left[k];
+        n += shards[i].games;
+    }
+    uint64_t seed = shards[0].seed;
+    long long last = shards[num_shards - 1].first + shards[num_shards - 1].games - 1;
+    free(shards);
+    fprintf(stderr, "%d shards, seed %llu: %lld games%s\n", num_shards, (unsigned long long)seed, n,
+            gaps ? "" : " (the same as one run of them all)");
+    if (gaps) fprintf(stderr, "Games 0 to %lld less %lld missing\n", last, gaps);
+
+    FILE *fptr = strcmp(output_path, "-") == 0 ? stdout : fopen(output_path, "w");
+    if (!fptr) {
+        perror("Error opening output file");
+        return 1;
+    }
+    write_outcomes(fptr, format, matches, n, seed, 0);
+    if (fptr != stdout ? fclose(fptr) != 0 : fflush(fptr) != 0) {
+        perror("Error writing output file");
+        return 1;
+    }
+    return 0;
+}
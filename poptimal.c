@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+#include "psolve.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing the solver.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Solves many deals and prints how often play()'s greedy policy and the best play
+ * leave each number of cards, side by side, with the solving rate. Under play()'s
+ * own rules the two always agree (see psolve.c); -d gives the player the extra
+ * freedom of starting a new pile at any time.
+ */
+int main(int argc, char *argv[]) {
+    long long n = 10000;        // Number of deals
+    uint64_t seed = 1;
+    int num_threads = 0;        // 0 means one per CPU
+    int free_deal = 0;          // 1 to allow a new pile while a move is possible
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:t:d")) != -1) {
+        char *end = NULL;
+        if (opt == 'n') n = strtoll(optarg, &end, 10);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10);
+        else if (opt == 't') num_threads = (int)strtol(optarg, &end, 10);
+        else if (opt == 'd') free_deal = 1;
+        else break;
+        if (end && *end != '\0') break; // Trailing junk after a number
+    }
+    if (opt != -1 || optind != argc || n < 1) {
+        fprintf(stderr, "Usage: %s [-n deals] [-s seed] [-t threads] [-d]\n", argv[0]);
+        fprintf(stderr, "  -n  number of deals (default 10000)\n");
+        fprintf(stderr, "  -s  seed; deals match pstatistics -s (default 1)\n");
+        fprintf(stderr, "  -t  threads (default 0 = one per CPU)\n");
+        fprintf(stderr, "  -d  let the player start a new pile even when a move is possible\n");
+        return 1;
+    }
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+
+    solveStats stats;
+    double t0 = now();
+    if (solve_many(n, seed, num_threads, free_deal, &stats) != 0) return 1;
+    double elapsed = now() - t0;
+
+    printf("Greedy play() vs best play%s over %lld deals (seed %llu)\n",
+           free_deal ? " (new piles allowed at any time)" : "", n, (unsigned long long)seed);
+    printf("%-10s %12s %9s %12s %9s\n", "cards left", "greedy", "%", "optimal", "%");
+    double greedy_sum = 0, optimal_sum = 0;
+    for (int i = 0; i < 53; i++) {
+        greedy_sum += (double)i * stats.greedy[i];
+        optimal_sum += (double)i * stats.optimal[i];
+        if (!stats.greedy[i] && !stats.optimal[i]) continue;
+        printf("%-10d %12lld %9.4f %12lld %9.4f\n", i, stats.greedy[i], 100.0 * stats.greedy[i] / n,
+               stats.optimal[i], 100.0 * stats.optimal[i] / n);
+    }
+    printf("mean cards left: greedy %.3f, optimal %.3f\n", greedy_sum / n, optimal_sum / n);
+    printf("best play beats greedy on %lld deals (%.2f%%)\n", stats.improved, 100.0 * stats.improved / n);
+    printf("%.3f s on %d threads: %.0f deals/minute, %.0f positions per deal\n", elapsed, num_threads,
+           60 * n / elapsed, (double)stats.nodes / n);
+    if (stats.worse) {
+        fprintf(stderr, "BUG: best play did worse than greedy on %lld deals\n", stats.worse);
+        return 1;
+    }
+    return 0;
+}
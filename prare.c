@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "psplit.h"
+
+#define Z_95 1.959963984540054 // Normal quantile for a two-sided 95% interval
+
+/**
+ * Returns the current monotonic time in seconds, for timing the estimators.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Estimates the chance of clearing all 52 cards two ways: by multilevel splitting
+ * (psplit.c), repeated independently to get a confidence interval, and by plain
+ * simulation. Then compares their cost at equal precision: the naive estimator's
+ * variance per game is p (1 - p), so the speedup is how much longer plain
+ * simulation would need to match the splitting estimate's variance.
+ */
+int main(int argc, char *argv[]) {
+    int replications = 100;     // Independent splitting runs
+    int particles = 1000;       // Games carried between levels in each run
+    int spacing = 5;            // Cards drawn between levels
+    long long naive_games = 1000000;
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:p:l:n:s:")) != -1) {
+        char *end = NULL;
+        if (opt == 'r') replications = (int)strtol(optarg, &end, 10);
+        else if (opt == 'p') particles = (int)strtol(optarg, &end, 10);
+        else if (opt == 'l') spacing = (int)strtol(optarg, &end, 10);
+        else if (opt == 'n') naive_games = strtoll(optarg, &end, 10);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10);
+        else break;
+        if (end && *end != '\0') break; // Trailing junk after a number
+    }
+    if (opt != -1 || optind != argc || replications < 2 || particles < 1 || spacing < 1 ||
+        naive_games < 1) {
+        fprintf(stderr, "Usage: %s [-r replications] [-p particles] [-l level spacing] [-n naive games] [-s seed]\n", argv[0]);
+        fprintf(stderr, "  -r  independent splitting runs, at least 2 (default 100)\n");
+        fprintf(stderr, "  -p  games carried from level to level in each run (default 1000)\n");
+        fprintf(stderr, "  -l  cards drawn between levels (default 5)\n");
+        fprintf(stderr, "  -n  games for the plain simulation (default 1000000)\n");
+        fprintf(stderr, "  -s  seed (default 1)\n");
+        return 1;
+    }
+
+    int levels[50];
+    int num_levels = split_levels(spacing, levels);
+    double fractions[50], mean_fractions[50] = {0};
+
+    // Splitting: the mean of the replications, with their spread for the interval
+    double sum = 0, sum_sq = 0;
+    double t0 = now();
+    for (int r = 0; r < replications; r++) {
+        Rng rng;
+        rng_seed(&rng, game_seed(seed, r));
+        double estimate = split_estimate(particles, levels, num_levels, &rng, fractions);
+        sum += estimate;
+        sum_sq += estimate * estimate;
+        for (int k = 0; k < num_levels; k++) mean_fractions[k] += fractions[k] / replications;
+    }
+    double split_time = now() - t0;
+    double p = sum / replications;
+    double variance = (sum_sq - replications * p * p) / (replications - 1); // Of one replication
+    if (variance < 0) variance = 0;
+    double split_half = Z_95 * sqrt(variance / replications);
+
+    // Plain simulation on one thread, like the splitting, with its own stream of games
+    t0 = now();
+    long long *remaining = many_plays_range(0, naive_games, seed + 1, 1);
+    double naive_time = now() - t0;
+    double q = (double)remaining[0] / naive_games;
+    double naive_half = Z_95 * sqrt(q * (1 - q) / naive_games);
+    free(remaining);
+
+    printf("Chance of clearing all 52 cards (seed %llu)\n", (unsigned long long)seed);
+    printf("Levels every %d cards; mean fraction reaching each from the last:\n", spacing);
+    for (int k = 0; k < num_levels; k++) {
+        printf("  %2d cards: %.4f\n", levels[k], mean_fractions[k]);
+    }
+    printf("%-10s %14s %14s %10s\n", "method", "estimate", "95% +/-", "seconds");
+    printf("%-10s %14.6g %14.6g %10.3f  (%d runs of %d games)\n", "splitting", p, split_half,
+           split_time, replications, particles);
+    printf("%-10s %14.6g %14.6g %10.3f  (%lld games)\n", "naive", q, naive_half, naive_time, naive_games);
+
+    // Work-normalised comparison: variance times time for each estimator
+    double naive_per_game = naive_time / naive_games;
+    double split_per_run = split_time / replications;
+    if (variance > 0) {
+        double speedup = p * (1 - p) * naive_per_game / (variance * split_per_run);
+        printf("naive would need %.3f s to match the splitting interval: speedup %.2fx\n",
+               split_time * speedup, speedup);
+    } else {
+        printf("every splitting run gave the same estimate; no speedup to report\n");
+    }
+    return 0;
+}
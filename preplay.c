@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "trace.h"
+#include "histogram.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing the recording.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Plays games first to first + n - 1 of a seed (shuffled exactly as pstatistics
+ * shuffles them) and records them to a compact trace.
+ * @param path File to write.
+ * @param first Index of the first game.
+ * @param n Number of games.
+ * @param seed Seed for the run.
+ * @return 0 on success, 1 on failure.
+ */
+static int record_games(const char *path, long long first, long long n, uint64_t seed) {
+    FILE *fptr = fopen(path, "wb");
+    if (!fptr) {
+        perror("Error opening trace file");
+        return 1;
+    }
+    TraceSink sink;
+    if (trace_open(&sink, TRACE_COMPACT, fptr, 0) != 0) {
+        fclose(fptr);
+        return 1;
+    }
+    double t0 = now();
+    for (long long i = first; i < first + n; i++) {
+        Rng rng;
+        rng_seed(&rng, game_seed(seed, i));
+        Deck deck = initialize_deck();
+        shuffle_fy(deck.cards, 52, &rng);
+        play_traced(&deck, &sink);
+    }
+    int status = trace_close(&sink);
+    long size = ftell(fptr);
+    if (fclose(fptr) != 0) status = -1;
+    if (status != 0) return 1;
+    double elapsed = now() - t0;
+    fprintf(stderr, "%lld games, seed %llu: %ld bytes (%.1f per game), %.3f s (%.0f games/s)\n",
+            n, (unsigned long long)seed, size, (double)size / n, elapsed, n / elapsed);
+    return 0;
+}
+
+/**
+ * Prints what a compact trace holds: how many games, the moves made and how many
+ * cards the games left.
+ * @param left Games ending with each number of cards left.
+ * @param moves Moves of each kind (indexed by Move).
+ * @param games Number of games.
+ */
+static void print_stats(const long long *left, const long long *moves, long long games) {
+    long long total_moves = moves[MOVE_PAIRS] + moves[MOVE_JQK] + moves[MOVE_NEW_PILE];
+    double sum = 0;
+    for (int k = 0; k < 53; k++) sum += (double)k * left[k];
+    printf("%lld games, %.2f moves per game (pairs %.2f, J Q K %.2f, new piles %.2f)\n",
+           games, (double)total_moves / games, (double)moves[MOVE_PAIRS] / games,
+           (double)moves[MOVE_JQK] / games, (double)moves[MOVE_NEW_PILE] / games);
+    printf("mean cards left %.4f, cleared %lld (%.4f%%)\n\n", sum / games, left[0], 100.0 * left[0] / games);
+
+    int labels[53];
+    double percentages[53];
+    for (int k = 0; k < 53; k++) {
+        labels[k] = k;
+        percentages[k] = 100.0 * left[k] / games;
+    }
+    fhistogram(stdout, labels, percentages, 53, 50);
+}
+
+/**
+ * Records games to a compact binary trace (-w), or reads one back: replaying every
+ * game from its deck to print its boards in the text format play() uses, or to sum
+ * up the whole trace (-S). Each replayed move is checked against the recorded one.
+ */
+int main(int argc, char *argv[]) {
+    const char *record_path = NULL;
+    long long n = 10000, first = 0, only = -1;
+    uint64_t seed = 1;
+    int verbose = 1, stats = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:n:s:r:g:pS")) != -1) {
+        char *end = NULL;
+        if (opt == 'w') record_path = optarg;
+        else if (opt == 'n') n = strtoll(optarg, &end, 10);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10);
+        else if (opt == 'r') first = strtoll(optarg, &end, 10);
+        else if (opt == 'g') only = strtoll(optarg, &end, 10);
+        else if (opt == 'p') verbose = 0;
+        else if (opt == 'S') stats = 1;
+        else break;
+        if (end && *end != '\0') break; // Trailing junk after a number
+    }
+    if (opt != -1 || n < 1 || first < 0 || only < -1 ||
+        (record_path ? optind != argc : optind != argc - 1)) {
+        fprintf(stderr, "Usage: %s -w file [-n games] [-s seed] [-r first game]\n", argv[0]);
+        fprintf(stderr, "       %s [-g game] [-p] [-S] file\n", argv[0]);
+        fprintf(stderr, "  -w  record games to this compact trace file\n");
+        fprintf(stderr, "  -n  games to record (default 10000)\n");
+        fprintf(stderr, "  -s  seed (default 1); game i is game i of pstatistics -s seed\n");
+        fprintf(stderr, "  -r  index of the first game to record (default 0)\n");
+        fprintf(stderr, "  -g  print only this game of the file (counting from 0)\n");
+        fprintf(stderr, "  -p  print plain boards, without notes on the moves\n");
+        fprintf(stderr, "  -S  print statistics of the whole file instead of boards\n");
+        return 1;
+    }
+    if (record_path) return record_games(record_path, first, n, seed);
+
+    const char *path = argv[optind];
+    FILE *fptr = fopen(path, "rb");
+    if (!fptr) {
+        perror("Error opening trace file");
+        return 1;
+    }
+    uint32_t version;
+    if (trace_read_header(fptr, &version) != 0 || version != TRACE_COMPACT_VERSION) {
+        fprintf(stderr, "%s is not a compact (version %d) trace\n", path, TRACE_COMPACT_VERSION);
+        fclose(fptr);
+        return 1;
+    }
+
+    TraceSink sink;
+    trace_open(&sink, stats ? TRACE_NONE : TRACE_TEXT, stdout, verbose);
+    long long left[53] = {0}, moves[4] = {0}, games = 0;
+    TraceGame game;
+    int status = 0, got;
+    while ((got = trace_read_game(fptr, &game)) == 1) {
+        int print = !stats && (only < 0 || games == only);
+        int cards_left = trace_replay(&game, print ? &sink : NULL);
+        if (cards_left < 0) {
+            fprintf(stderr, "Game %lld of %s does not replay as recorded\n", games, path);
+            status = 1;
+            break;
+        }
+        if (print && only < 0) fputc('\n', stdout); // Between games, as many_plays() prints them
+        left[cards_left]++;
+        for (int i = 0; i < game.num_moves; i++) moves[TRACE_BYTE_MOVE(game.moves[i])]++;
+        if (++games > only && only >= 0 && !stats) break;
+    }
+    if (got < 0) {
+        fprintf(stderr, "%s is damaged or cut short after %lld games\n", path, games);
+        status = 1;
+    }
+    fclose(fptr);
+    if (trace_close(&sink) != 0) status = 1;
+    if (status == 0 && only >= games) {
+        fprintf(stderr, "%s has only %lld games\n", path, games);
+        status = 1;
+    }
+    if (status == 0 && stats && games) print_stats(left, moves, games);
+    return status;
+}
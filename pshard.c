@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "histogram.h"
+#include "pshard.h"
+
+/*
+ * Shard files let one long run be split between processes or machines, and let a
+ * killed run pick up where it stopped. Game i of a seed is always shuffled from
+ * game_seed(seed, i), whoever plays it, so shards covering 0 to n - 1 add up to
+ * exactly the counts of a single run of n games.
+ *
+ * The file is plain text, one key and its value(s) per line:
+ *
+ *   patience-shard 1
+ *   seed 42
+ *   first 0
+ *   games 1000000
+ *   done 250000
+ *   left 0 3 17 ...        (53 counts: 0 to 52 cards left)
+ *
+ * A new version of the file is written next to the old one and renamed over it, so
+ * a run killed mid-write still leaves the last complete checkpoint behind.
+ */
+
+#define Z_95 1.959963984540054 // Normal quantile for a two-sided 95% interval
+
+/**
+ * Reads a shard file.
+ * @param path The file.
+ * @param shard Receives the shard.
+ * @return 0 on success, 1 if there is no such file, -1 if it can't be read or is
+ *         malformed (with a message on stderr).
+ */
+int shard_read(const char *path, Shard *shard) {
+    FILE *fptr = fopen(path, "r");
+    if (!fptr) {
+        if (errno == ENOENT) return 1;
+        perror("Error opening shard file");
+        return -1;
+    }
+    memset(shard, 0, sizeof(*shard));
+    int version = 0, ok = fscanf(fptr, " patience-shard %d", &version) == 1 && version == SHARD_VERSION;
+    unsigned long long seed = 0;
+    ok = ok && fscanf(fptr, " seed %llu", &seed) == 1;
+    ok = ok && fscanf(fptr, " first %lld", &shard->first) == 1;
+    ok = ok && fscanf(fptr, " games %lld", &shard->games) == 1;
+    ok = ok && fscanf(fptr, " done %lld", &shard->done) == 1;
+    int pos = -1;
+    if (ok) fscanf(fptr, " left%n", &pos);
+    ok = ok && pos >= 0;
+    long long sum = 0;
+    for (int i = 0; i < 53 && ok; i++) {
+        ok = fscanf(fptr, "%lld", &shard->left[i]) == 1 && shard->left[i] >= 0;
+        sum += shard->left[i];
+    }
+    if (ok) fscanf(fptr, " ");
+    ok = ok && fgetc(fptr) == EOF; // Nothing after the counts
+    fclose(fptr);
+    shard->seed = seed;
+
+    // The counts must account for exactly the games done
+    if (!ok || shard->first < 0 || shard->games < 1 || shard->done < 0 ||
+        shard->done > shard->games || sum != shard->done) {
+        fprintf(stderr, "%s is not a valid version %d shard file\n", path, SHARD_VERSION);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Writes a shard file, replacing any old one only once the new one is complete.
+ * @param path The file.
+ * @param shard The shard.
+ * @return 0 on success, -1 on failure (with a message on stderr).
+ */
+int shard_write(const char *path, const Shard *shard) {
+    size_t len = strlen(path);
+    char *tmp_path = malloc(len + 5);
+    if (!tmp_path) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    memcpy(tmp_path, path, len);
+    memcpy(tmp_path + len, ".tmp", 5);
+
+    FILE *fptr = fopen(tmp_path, "w");
+    if (!fptr) {
+        perror("Error opening shard file");
+        free(tmp_path);
+        return -1;
+    }
+    fprintf(fptr, "patience-shard %d\nseed %llu\nfirst %lld\ngames %lld\ndone %lld\nleft",
+            SHARD_VERSION, (unsigned long long)shard->seed, shard->first, shard->games, shard->done);
+    for (int i = 0; i < 53; i++) fprintf(fptr, " %lld", shard->left[i]);
+    fprintf(fptr, "\n");
+    int status = 0;
+    if (fclose(fptr) != 0 || rename(tmp_path, path) != 0) {
+        perror("Error writing shard file");
+        remove(tmp_path);
+        status = -1;
+    }
+    free(tmp_path);
+    return status;
+}
+
+/**
+ * Half-width of the 95% confidence interval for a bucket's probability, from the
+ * normal approximation to the binomial: z * sqrt(p (1 - p) / n).
+ * @param count Games that fell in the bucket.
+ * @param n Games played.
+ * @return The half-width, as a probability.
+ */
+double outcome_half_width(long long count, long long n) {
+    double p = (double)count / n;
+    return Z_95 * sqrt(p * (1 - p) / n);
+}
+
+/**
+ * Writes the outcome histogram (how often each number of cards, 0 to 52, was left)
+ * in the chosen format. CSV and JSON also give each percentage's 95% confidence
+ * interval half-width, in percentage points.
+ * @param fptr Stream to write to.
+ * @param format FORMAT_TEXT, FORMAT_CSV or FORMAT_JSON.
+ * @param matches Games ending with each number of cards left.
+ * @param n Number of games played.
+ * @param seed Seed of the run.
+ * @param num_threads Threads the run used, or 0 if not known (left out of the JSON).
+ */
+void write_outcomes(FILE *fptr, int format, const long long *matches, long long n,
+                    uint64_t seed, int num_threads) {
+    int num_labels = 53;        // Fixed to include all possibilities: 0 to 52 cards left
+    int labels[53];
+    double percentages[53];
+    for (int i = 0; i < num_labels; i++) {
+        labels[i] = i;      // Labels are 0, 1, 2, ..., 52
+        percentages[i] = (matches[i] * 100.0) / n;  // Percentage for each number of cards left
+    }
+
+    if (format == FORMAT_TEXT) {
+        fhistogram(fptr, labels, percentages, num_labels, 50);
+    } else if (format == FORMAT_CSV) {
+        fprintf(fptr, "cards_left,games,percent,ci95\n");
+        for (int i = 0; i < num_labels; i++) {
+            fprintf(fptr, "%d,%lld,%.10g,%.10g\n", labels[i], matches[i], percentages[i],
+                    100 * outcome_half_width(matches[i], n));
+        }
+    } else {
+        fprintf(fptr, "{\"games\": %lld, \"seed\": %llu", n, (unsigned long long)seed);
+        if (num_threads > 0) fprintf(fptr, ", \"threads\": %d", num_threads);
+        fprintf(fptr, ", \"outcomes\": [");
+        for (int i = 0; i < num_labels; i++) {
+            fprintf(fptr, "%s\n  {\"cards_left\": %d, \"games\": %lld, \"percent\": %.10g, \"ci95\": %.10g}",
+                    i ? "," : "", labels[i], matches[i], percentages[i],
+                    100 * outcome_half_width(matches[i], n));
+        }
+        fprintf(fptr, "\n]}\n");
+    }
+}
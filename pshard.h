@@ -0,0 +1,32 @@
+#ifndef PSHARD_H
+#define PSHARD_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define SHARD_VERSION 1
+
+// Ways to write out the outcome histogram
+enum {
+    FORMAT_TEXT,    // Bar chart, as phistogram.txt has always been
+    FORMAT_CSV,     // cards_left,games,percent,ci95 rows
+    FORMAT_JSON     // One object with the run's settings and every bucket
+};
+
+// A contiguous range of a seed's games and how they came out so far: a checkpoint
+// while the range is being played, and a result file to merge once it is done
+typedef struct Shard {
+    uint64_t seed;
+    long long first;            // Index of the shard's first game
+    long long games;            // Games in the shard
+    long long done;             // Games played so far (first to first + done - 1)
+    long long left[53];         // Of those, how many ended with each number of cards left
+} Shard;
+
+int shard_read(const char *path, Shard *shard);
+int shard_write(const char *path, const Shard *shard);
+double outcome_half_width(long long count, long long n);
+void write_outcomes(FILE *fptr, int format, const long long *matches, long long n,
+                    uint64_t seed, int num_threads);
+
+#endif
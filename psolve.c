@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "psolve.h"
+
+/*
+ * Best play of a patience deal. play() always covers every pair adding to 11 that
+ * add_to_11 finds, and only looks for J, Q, K when there are none; here the player
+ * may instead cover any one pair, or J, Q, K, whenever they are showing. A new pile
+ * is still only started when neither is possible, and the game still ends at 9
+ * piles or when the deck runs out. The search looks for the line of play that draws
+ * the most cards.
+ *
+ * Under those rules the choice turns out never to matter. Two different moves cover
+ * piles of different values, so making one leaves the other still possible, and
+ * making both in either order draws the same cards and removes the same values: every
+ * order of moves ends in the same position, and the best result is play()'s. The
+ * solver confirms this deal by deal. With free_deal set it may also start a new pile
+ * while a move is possible (holding a pair back for later); the solver then searches
+ * a genuinely larger tree, though on random deals it has not yet found a deal where
+ * holding back helps.
+ *
+ * Which pile shows which card does not matter to the rest of the game, only how
+ * many piles show each value, so a position is just those 13 counts (4 bits each)
+ * plus how many cards have been drawn: 58 bits, packed into one 64-bit key. The best
+ * result from each position is kept in a transposition table, as the same position
+ * is reached by many orders of moves. A line that clears the deck cannot be beaten,
+ * so the search stops as soon as it finds one.
+ */
+
+#define VALUE_BITS 4
+#define TOP_SHIFT (13 * VALUE_BITS)
+
+// One transposition table slot: a position and the most cards that can be drawn from it
+typedef struct ttEntry {
+    uint64_t key;
+    uint32_t deal;      // Which deal the entry belongs to (the key depends on the deck)
+    uint32_t best;
+} ttEntry;
+
+struct Solver {
+    ttEntry *table;
+    uint64_t mask;      // Table size - 1 (a power of 2)
+    uint32_t deal;      // Number of the deal being solved; 0 marks an empty slot
+    const int *cards;   // Deck being solved
+    int free_deal;      // 1 if a new pile may be started while a move is possible
+    long long nodes;
+};
+
+/**
+ * Makes a solver with a transposition table of 2^table_bits slots.
+ * @param table_bits Log2 of the table size.
+ * @param free_deal 1 to allow starting a new pile while a move is possible.
+ * @return The solver, or NULL if memory allocation fails.
+ */
+Solver *solver_create(int table_bits, int free_deal) {
+    Solver *solver = calloc(1, sizeof(Solver));
+    if (!solver) {
+        perror("Memory allocation failed for solver");
+        return NULL;
+    }
+    solver->table = calloc((size_t)1 << table_bits, sizeof(ttEntry));
+    if (!solver->table) {
+        perror("Memory allocation failed for transposition table");
+        free(solver);
+        return NULL;
+    }
+    solver->mask = ((uint64_t)1 << table_bits) - 1;
+    solver->free_deal = free_deal;
+    return solver;
+}
+
+/**
+ * Frees a solver and its table.
+ * @param solver The solver (may be NULL).
+ */
+void solver_free(Solver *solver) {
+    if (!solver) return;
+    free(solver->table);
+    free(solver);
+}
+
+/**
+ * Returns how many positions a solver has searched, over all its deals.
+ * @param solver The solver.
+ * @return Positions searched.
+ */
+long long solver_nodes(const Solver *solver) {
+    return solver->nodes;
+}
+
+/**
+ * Counts of each value in a packed position.
+ * @param key The position.
+ * @param v Card value, 1 to 13.
+ * @return Piles showing v.
+ */
+static inline int key_count(uint64_t key, int v) {
+    return (int)(key >> ((v - 1) * VALUE_BITS)) & 0xF;
+}
+
+/**
+ * Covers piles showing the given values with the next cards, in order, until the
+ * deck runs out.
+ * @param solver The solver (for the deck).
+ * @param key The position.
+ * @param values Values of the piles to cover.
+ * @param count Number of piles to cover.
+ * @return The position afterwards.
+ */
+static inline uint64_t cover(const Solver *solver, uint64_t key, const int *values, int count) {
+    int top = (int)(key >> TOP_SHIFT);
+    for (int i = 0; i < count && top < 52; i++) {
+        int card = solver->cards[top++];
+        key -= (uint64_t)1 << ((values[i] - 1) * VALUE_BITS);
+        key += (uint64_t)1 << ((card - 1) * VALUE_BITS);
+    }
+    return (key & (((uint64_t)1 << TOP_SHIFT) - 1)) | (uint64_t)top << TOP_SHIFT;
+}
+
+/**
+ * Finds the most cards that can be drawn from a position.
+ * @param solver The solver.
+ * @param key The position.
+ * @return Cards drawn at the end of the best line of play.
+ */
+static int search(Solver *solver, uint64_t key) {
+    int top = (int)(key >> TOP_SHIFT);
+    int piles = 0;
+    for (int v = 1; v <= 13; v++) piles += key_count(key, v);
+    if (piles >= 9 || top >= 52) return top;
+
+    uint64_t slot = (key * 0x9E3779B97F4A7C15ULL) >> 32 & solver->mask;
+    ttEntry *entry = &solver->table[slot];
+    if (entry->deal == solver->deal && entry->key == key) return (int)entry->best;
+    solver->nodes++;
+
+    int best = top, moved = 0;
+    for (int v = 1; v <= 5 && best < 52; v++) {
+        if (key_count(key, v) && key_count(key, 11 - v)) {
+            int values[2] = {v, 11 - v};
+            int result = search(solver, cover(solver, key, values, 2));
+            if (result > best) best = result;
+            moved = 1;
+        }
+    }
+    if (best < 52 && key_count(key, 11) && key_count(key, 12) && key_count(key, 13)) {
+        int values[3] = {11, 12, 13};
+        int result = search(solver, cover(solver, key, values, 3));
+        if (result > best) best = result;
+        moved = 1;
+    }
+    if (best < 52 && (!moved || solver->free_deal)) { // Start a new pile
+        int card = solver->cards[top];
+        int result = search(solver, (key + ((uint64_t)1 << ((card - 1) * VALUE_BITS)) +
+                                     ((uint64_t)1 << TOP_SHIFT)));
+        if (result > best) best = result;
+    }
+
+    entry->key = key;
+    entry->deal = solver->deal;
+    entry->best = (uint32_t)best;
+    return best;
+}
+
+/**
+ * Finds the fewest cards a deal can be left with under free choice of moves.
+ * @param solver The solver.
+ * @param deck The deal (its top position is ignored).
+ * @return Cards left at the end of the best line of play.
+ */
+int solve_deal(Solver *solver, const Deck *deck) {
+    if (++solver->deal == 0) { // Numbers wrapped round: empty the table for real
+        memset(solver->table, 0, (solver->mask + 1) * sizeof(ttEntry));
+        solver->deal = 1;
+    }
+    solver->cards = deck->cards;
+    uint64_t key = (uint64_t)2 << TOP_SHIFT;
+    key += (uint64_t)1 << ((deck->cards[0] - 1) * VALUE_BITS);
+    key += (uint64_t)1 << ((deck->cards[1] - 1) * VALUE_BITS);
+    return 52 - search(solver, key);
+}
+
+// One thread's share of solve_many: a contiguous range of deals
+typedef struct solveWorker {
+    uint64_t seed;
+    int free_deal;
+    long long first;
+    long long count;
+    solveStats stats;
+    int failed;
+} solveWorker;
+
+/**
+ * Plays and solves one thread's range of deals. Deal i is shuffled exactly as
+ * many_plays_parallel shuffles game i, so the greedy results match it.
+ * @param arg Pointer to the thread's solveWorker.
+ * @return NULL.
+ */
+static void *solve_worker(void *arg) {
+    solveWorker *w = arg;
+    Solver *solver = solver_create(20, w->free_deal);
+    if (!solver) {
+        w->failed = 1;
+        return NULL;
+    }
+    for (long long i = w->first; i < w->first + w->count; i++) {
+        Rng rng;
+        rng_seed(&rng, game_seed(w->seed, i));
+        Deck deck = initialize_deck();
+        shuffle_fy(deck.cards, 52, &rng);
+        int best = solve_deal(solver, &deck);
+        int greedy = play_flat(&deck);
+        w->stats.greedy[greedy]++;
+        w->stats.optimal[best]++;
+        w->stats.improved += best < greedy;
+        w->stats.worse += best > greedy;
+    }
+    w->stats.nodes = solver_nodes(solver);
+    solver_free(solver);
+    return NULL;
+}
+
+/**
+ * Solves n deals across several threads, alongside play()'s result for each.
+ * @param n Number of deals.
+ * @param seed Seed for the deals (the same deals as many_plays_parallel plays).
+ * @param num_threads Number of threads to use (0 means one per CPU).
+ * @param free_deal 1 to allow starting a new pile while a move is possible.
+ * @param stats Receives the combined results.
+ * @return 0 on success, -1 if memory allocation fails.
+ */
+int solve_many(long long n, uint64_t seed, int num_threads, int free_deal, solveStats *stats) {
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
+    solveWorker *workers = calloc(num_threads, sizeof(solveWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!workers || !threads) {
+        perror("Memory allocation failed for solver threads");
+        free(workers);
+        free(threads);
+        return -1;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        workers[t].seed = seed;
+        workers[t].free_deal = free_deal;
+        workers[t].first = n * t / num_threads;
+        workers[t].count = n * (t + 1) / num_threads - workers[t].first;
+        if (t > 0 && pthread_create(&threads[t], NULL, solve_worker, &workers[t]) != 0) {
+            perror("Failed to start solver thread");
+            exit(1);
+        }
+    }
+    solve_worker(&workers[0]); // The main thread takes the first range itself
+    for (int t = 1; t < num_threads; t++) pthread_join(threads[t], NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    int failed = 0;
+    for (int t = 0; t < num_threads; t++) {
+        failed |= workers[t].failed;
+        for (int i = 0; i < 53; i++) {
+            stats->greedy[i] += workers[t].stats.greedy[i];
+            stats->optimal[i] += workers[t].stats.optimal[i];
+        }
+        stats->improved += workers[t].stats.improved;
+        stats->worse += workers[t].stats.worse;
+        stats->nodes += workers[t].stats.nodes;
+    }
+    free(workers);
+    free(threads);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef PSOLVE_H
+#define PSOLVE_H
+
+#include <stdint.h>
+#include "patience.h"
+
+// Results of solving a range of deals: outcome histograms for play() and for the
+// best play, indexed by cards left
+typedef struct solveStats {
+    long long greedy[53];
+    long long optimal[53];
+    long long improved;     // Deals where the best play beats play()
+    long long worse;        // Deals where it somehow does not match play() (a bug)
+    long long nodes;        // States searched
+} solveStats;
+
+typedef struct Solver Solver;
+
+Solver *solver_create(int table_bits, int free_deal);
+void solver_free(Solver *solver);
+int solve_deal(Solver *solver, const Deck *deck);
+long long solver_nodes(const Solver *solver);
+int solve_many(long long n, uint64_t seed, int num_threads, int free_deal, solveStats *stats);
+
+#endif
@@ -0,0 +1,70 @@
+#include "patience.h"
+#include "pspec.h"
+
+/*
+ * Patience engines with the deck size, pile limit and target fixed at compile time:
+ * each is the body in pengine.h with those as constants, so the bounds of every loop
+ * are known to the compiler. play_cards (patience.c) is the same body with them as
+ * runtime parameters, for comparison and for any other configuration. Adding an
+ * engine takes one more block below and a line in spec_engines.
+ */
+
+/**
+ * Plays a standard 52-card game: 9 piles, pairs adding to 11, J, Q, K covered.
+ * @param cards The 52 cards, in the order they are drawn.
+ * @return Cards left in the deck at the end of the game.
+ */
+#define ENGINE_NAME play_52_9_11
+#define ENGINE_PARAMS
+#define ENGINE_DECK_SIZE 52
+#define ENGINE_MAX_PILES 9
+#define ENGINE_TARGET 11
+#define ENGINE_JQK 1
+#define ENGINE_PILE_CAP 9
+#include "pengine.h"
+
+/**
+ * Plays a half-deck game: 26 cards (two of each value), 7 piles, pairs adding to 11.
+ * @param cards The 26 cards, in the order they are drawn.
+ * @return Cards left in the deck at the end of the game.
+ */
+#define ENGINE_NAME play_26_7_11
+#define ENGINE_PARAMS
+#define ENGINE_DECK_SIZE 26
+#define ENGINE_MAX_PILES 7
+#define ENGINE_TARGET 11
+#define ENGINE_JQK 1
+#define ENGINE_PILE_CAP 7
+#include "pengine.h"
+
+/**
+ * Plays a two-deck game: 104 cards, 12 piles, pairs adding to 11.
+ * @param cards The 104 cards, in the order they are drawn.
+ * @return Cards left in the deck at the end of the game.
+ */
+#define ENGINE_NAME play_104_12_11
+#define ENGINE_PARAMS
+#define ENGINE_DECK_SIZE 104
+#define ENGINE_MAX_PILES 12
+#define ENGINE_TARGET 11
+#define ENGINE_JQK 1
+#define ENGINE_PILE_CAP 12
+#include "pengine.h"
+
+const specEngine spec_engines[] = {
+    {"52/9/11", 52, 9, 11, play_52_9_11},
+    {"26/7/11", 26, 7, 11, play_26_7_11},
+    {"104/12/11", 104, 12, 11, play_104_12_11},
+};
+const int num_spec_engines = sizeof(spec_engines) / sizeof(spec_engines[0]);
+
+/**
+ * Fills an unshuffled deck of any multiple of 13 cards: values 1-13, repeating.
+ * @param cards Array of size to fill.
+ * @param size Number of cards.
+ */
+void initialize_cards(int *cards, int size) {
+    for (int i = 0; i < size; i++) {
+        cards[i] = (i % 13) + 1; // Values 1-13, cycling every 13 cards
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef PSPEC_H
+#define PSPEC_H
+
+// An engine specialised at compile time for one configuration (see pengine.h)
+typedef struct specEngine {
+    const char *name;
+    int deck_size;
+    int max_piles;
+    int target;
+    int (*play)(const int *cards);
+} specEngine;
+
+extern const specEngine spec_engines[];
+extern const int num_spec_engines;
+
+int play_52_9_11(const int *cards);
+int play_26_7_11(const int *cards);
+int play_104_12_11(const int *cards);
+void initialize_cards(int *cards, int size);
+
+#endif
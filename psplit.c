@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "patience.h"
+#include "shuffle.h"
+#include "psplit.h"
+
+/*
+ * Multilevel splitting for the chance of clearing the whole deck. A game only
+ * clears if it first draws 10 cards, then 20, and so on, so the rare event is
+ * split into a chain of likelier ones: how many cards have been drawn is the level.
+ * A fixed number of games (particles) is pushed from one level to the next; those
+ * that die stop, and the survivors are cloned back up to full strength before the
+ * next stage. The product of the fractions surviving each stage is an unbiased
+ * estimate of the probability.
+ *
+ * Cloning is sound because the future of a game depends only on its board and on
+ * which cards are still undrawn, and given everything seen so far the undrawn cards
+ * are in a uniformly random order. So the decks are never shuffled up front: each
+ * card is picked at random from the undrawn ones just before it is drawn (a
+ * Fisher-Yates shuffle done lazily). Clones are then plain copies whose futures are
+ * still independent, and cloning costs nothing like a reshuffle of the deck.
+ */
+
+// A game in progress
+typedef struct Particle {
+    Board board;
+    Deck deck;
+} Particle;
+
+/**
+ * Picks the next cards of a deck at random from those not yet drawn, one swap each.
+ * @param deck The deck.
+ * @param count Number of cards about to be drawn.
+ * @param rng Generator to draw from.
+ */
+static void draw_lazily(Deck *deck, int count, Rng *rng) {
+    for (int pos = deck->top; pos < deck->top + count && pos < 51; pos++) {
+        int k = pos + (int)rng_bounded(rng, (uint32_t)(52 - pos));
+        int tmp = deck->cards[pos]; deck->cards[pos] = deck->cards[k]; deck->cards[k] = tmp;
+    }
+}
+
+/**
+ * Plays a game until it has drawn at least a given number of cards or is over.
+ * @param p The game.
+ * @param level Cards drawn to stop at.
+ * @param rng Generator for the cards drawn.
+ */
+static void play_to_level(Particle *p, int level, Rng *rng) {
+    int piles[18], count;
+    while (p->deck.top < level) {
+        Move move = board_find_move(&p->board, &p->deck, piles, &count);
+        if (move == MOVE_NONE) return;
+        draw_lazily(&p->deck, move == MOVE_NEW_PILE ? 1 : count, rng);
+        board_apply(&p->board, &p->deck, move, piles, count);
+    }
+}
+
+/**
+ * Fills in evenly spaced levels (cards drawn) from the start of a game to a full
+ * clearance: 2 + spacing, 2 + 2 * spacing, ..., always ending at 52.
+ * @param spacing Cards between levels (at least 1).
+ * @param levels Array of at least 50 to receive the levels.
+ * @return Number of levels.
+ */
+int split_levels(int spacing, int *levels) {
+    int count = 0;
+    for (int level = 2 + spacing; level < 52; level += spacing) levels[count++] = level;
+    levels[count++] = 52;
+    return count;
+}
+
+/**
+ * Estimates the probability of clearing all 52 cards by fixed-effort multilevel
+ * splitting. Each call is one independent replication; average several and use
+ * their spread for a confidence interval.
+ * @param particles Games carried from level to level.
+ * @param levels Increasing cards-drawn levels, the last being 52.
+ * @param num_levels Number of levels.
+ * @param rng Generator for the shuffles and the cloning.
+ * @param fractions Array of num_levels to receive the fraction of games reaching each
+ *                  level from the one before (0 past the point where none did), or NULL.
+ * @return The estimate.
+ */
+double split_estimate(int particles, const int *levels, int num_levels, Rng *rng, double *fractions) {
+    Particle *games = malloc(particles * sizeof(Particle));
+    Particle *clones = malloc(particles * sizeof(Particle));
+    int *survivors = malloc(particles * sizeof(int));
+    if (!games || !clones || !survivors) {
+        perror("Memory allocation failed for splitting");
+        exit(1);
+    }
+    for (int i = 0; i < particles; i++) {
+        games[i].deck = initialize_deck();
+        draw_lazily(&games[i].deck, 2, rng);
+        board_init(&games[i].board, &games[i].deck);
+    }
+
+    double estimate = 1;
+    for (int k = 0; k < num_levels; k++) {
+        // Play every game until it reaches the level or ends
+        int alive = 0;
+        for (int i = 0; i < particles; i++) {
+            play_to_level(&games[i], levels[k], rng);
+            if (games[i].deck.top >= levels[k]) survivors[alive++] = i;
+        }
+        estimate *= (double)alive / particles;
+        if (fractions) fractions[k] = (double)alive / particles;
+        if (alive == 0) {
+            for (k++; fractions && k < num_levels; k++) fractions[k] = 0;
+            break;
+        }
+        if (k == num_levels - 1) break;
+
+        // Refill by cloning survivors picked at random
+        for (int i = 0; i < particles; i++) clones[i] = games[survivors[rng_bounded(rng, alive)]];
+        Particle *swap = games;
+        games = clones;
+        clones = swap;
+    }
+
+    free(games);
+    free(clones);
+    free(survivors);
+    return estimate;
+}
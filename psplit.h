@@ -0,0 +1,10 @@
+#ifndef PSPLIT_H
+#define PSPLIT_H
+
+#include "patience.h"
+#include "shuffle.h"
+
+int split_levels(int spacing, int *levels);
+double split_estimate(int particles, const int *levels, int num_levels, Rng *rng, double *fractions);
+
+#endif
@@ -1,66 +1,259 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "patience.h"
 #include "shuffle.h"
-#include "histogram.h"
-#include <unistd.h>
-#include <fcntl.h>
+#include "pshard.h"
 
-int main()
-{
-    int n = 10000;              // Number of simulations
-    int num_labels = 53;        // Fixed to include all possibilities: 0 to 52 cards left
-    fflush(stdout);
-    int *matches = many_plays(n);  // Simulate n games and get frequency of cards left
+#define Z_95 1.959963984540054 // Normal quantile for a two-sided 95% interval
+
+/**
+ * Returns the current monotonic time in seconds, for timing the run.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Relative error of a bucket's estimate: the interval half-width over the estimate.
+ * @param count Games that fell in the bucket (must be at least 1).
+ * @param n Games played.
+ * @return The relative error (0.01 means +/- 1%).
+ */
+static double relative_error(long long count, long long n) {
+    return outcome_half_width(count, n) / ((double)count / n);
+}
 
-    // Allocate and populate labels array with all possible outcomes (0 to 52)
-    int *labels = malloc(num_labels * sizeof(int));
-    if (!labels) {
-        perror("Memory allocation failed for labels");
+/**
+ * Games needed in total for a bucket to reach a relative error, taking the current
+ * estimate of its probability as the truth: n = z^2 (1 - p) / (p e^2).
+ * @param count Games that fell in the bucket so far (must be at least 1).
+ * @param n Games played so far.
+ * @param target Target relative error.
+ * @return The estimated number of games.
+ */
+static double games_needed(long long count, long long n, double target) {
+    double p = (double)count / n;
+    return Z_95 * Z_95 * (1 - p) / (p * target * target);
+}
+
+/**
+ * Plays games in batches until the chosen buckets are known to a target relative
+ * error (95% confidence), or a cap on the number of games is hit. Batch k plays the
+ * next range of game indices, so the counts are exactly those of a fixed run of the
+ * same total length with the same seed. After each batch, the next is sized from the
+ * current estimates to reach the target, but never more than doubles the run so far
+ * (early estimates are rough) and never goes below the first batch.
+ * @param first_batch Games in the first batch.
+ * @param max_games Cap on the total number of games.
+ * @param target Target relative error.
+ * @param bucket Bucket to target (cards left), or -1 for every bucket seen so far.
+ * @param floor With every bucket targeted, skip those estimated to be rarer than this
+ *              (the rarest outcomes would otherwise need billions of games).
+ * @param seed Seed for the run.
+ * @param num_threads Threads to use.
+ * @param games Receives the number of games played.
+ * @return Array where index is cards left, value is frequency of that outcome.
+ */
+static long long *plays_until_precise(long long first_batch, long long max_games, double target,
+                                      int bucket, double floor, uint64_t seed, int num_threads,
+                                      long long *games) {
+    long long *matches = calloc(53, sizeof(long long));
+    if (!matches) {
+        perror("Memory allocation failed");
         exit(1);
     }
-    for (int i = 0; i < num_labels; i++) {
-        labels[i] = i;      // Labels are 0, 1, 2, ..., 52
+    long long n = 0, batch = first_batch < max_games ? first_batch : max_games;
+    while (batch > 0) {
+        long long *counts = many_plays_range(n, batch, seed, num_threads);
+        for (int i = 0; i < 53; i++) matches[i] += counts[i];
+        free(counts);
+        n += batch;
+
+        // The worst of the targeted buckets decides whether to stop and how far to go
+        double worst = 0, needed = 0;
+        int worst_bucket = bucket;
+        for (int i = 0; i < 53; i++) {
+            if (bucket >= 0 && i != bucket) continue;
+            if (matches[i] == 0) {
+                if (bucket >= 0) worst = INFINITY, needed = 2.0 * n; // Not seen yet: keep doubling
+                continue;
+            }
+            if (bucket < 0 && (double)matches[i] / n < floor) continue;
+            double error = relative_error(matches[i], n);
+            if (error > worst) {
+                worst = error;
+                worst_bucket = i;
+            }
+            double want = games_needed(matches[i], n, target);
+            if (want > needed) needed = want;
+        }
+        fprintf(stderr, "%lld games: worst relative error %.4g (%d cards left)\n", n, worst, worst_bucket);
+        if (worst <= target) break;
+
+        double next = needed - n;
+        if (next > n) next = n;
+        if (next < first_batch) next = first_batch;
+        batch = next < max_games - n ? (long long)ceil(next) : max_games - n;
+        if (batch == 0) fprintf(stderr, "Stopped at the cap of %lld games before reaching the target\n", max_games);
     }
+    *games = n;
+    return matches;
+}
 
-    // Allocate and calculate percentages for all possible outcomes
-    double *percentages = malloc(num_labels * sizeof(double));
-    if (!percentages) {
-        perror("Memory allocation failed for percentages");
-        exit(1);
+/**
+ * Plays a shard's remaining games in batches, writing the shard to its checkpoint
+ * file after each one, so a run that is killed can be resumed from the last batch.
+ * The batches are ranges of game indices, so the counts come out exactly as if the
+ * shard had been played in one go.
+ * @param shard The shard so far (updated as games are played).
+ * @param path Checkpoint file.
+ * @param every Games between checkpoints.
+ * @param num_threads Threads to use.
+ * @return 0 on success, -1 if a checkpoint could not be written.
+ */
+static int plays_with_checkpoints(Shard *shard, const char *path, long long every, int num_threads) {
+    while (shard->done < shard->games) {
+        long long batch = shard->games - shard->done < every ? shard->games - shard->done : every;
+        long long *counts = many_plays_range(shard->first + shard->done, batch, shard->seed, num_threads);
+        for (int i = 0; i < 53; i++) shard->left[i] += counts[i];
+        free(counts);
+        shard->done += batch;
+        if (shard_write(path, shard) != 0) return -1;
+        fprintf(stderr, "%lld of %lld games done\n", shard->done, shard->games);
     }
-    for (int i = 0; i < num_labels; i++) {
-        percentages[i] = (matches[i] * 100.0) / n;  // Percentage for each number of cards left
+    return 0;
+}
+
+/**
+ * Simulates many games of patience and writes how often each number of cards is
+ * left at the end. By default it plays 10000 games on every CPU, seeded from the
+ * clock, and writes the bar chart to phistogram.txt; flags change each of these.
+ * With -e it instead keeps playing until the estimates are as precise as asked.
+ * With -k it plays one shard of a run (games -r to -r + n - 1), checkpointing to a
+ * shard file that later runs resume from and pmerge combines with other shards.
+ * The run's settings and timing go to stderr, so a run can be repeated exactly.
+ */
+int main(int argc, char *argv[])
+{
+    long long n = 10000;        // Number of simulations
+    uint64_t seed = (uint64_t)time(NULL);
+    int seed_given = 0;
+    int num_threads = 0;        // 0 means one per CPU
+    const char *output_path = "phistogram.txt";
+    int format = FORMAT_TEXT;
+    double target = 0;          // Target relative error; 0 plays exactly n games
+    int bucket = -1;            // Bucket to target, or -1 for all of them
+    long long max_games = 100000000;
+    double floor = 0.001;       // Rarest bucket probability targeted when targeting all
+    long long first = 0;        // Index of the first game
+    const char *checkpoint_path = NULL;
+    long long every = 1000000;  // Games between checkpoints
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:t:o:f:e:c:m:p:r:k:b:")) != -1) {
+        char *end = NULL;
+        if (opt == 'n') n = strtoll(optarg, &end, 10);
+        else if (opt == 'e') target = strtod(optarg, &end);
+        else if (opt == 'c') bucket = (int)strtol(optarg, &end, 10);
+        else if (opt == 'm') max_games = strtoll(optarg, &end, 10);
+        else if (opt == 'p') floor = strtod(optarg, &end);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10), seed_given = 1;
+        else if (opt == 'r') first = strtoll(optarg, &end, 10);
+        else if (opt == 'k') checkpoint_path = optarg;
+        else if (opt == 'b') every = strtoll(optarg, &end, 10);
+        else if (opt == 't') num_threads = (int)strtol(optarg, &end, 10);
+        else if (opt == 'o') output_path = optarg;
+        else if (opt == 'f') {
+            if (strcmp(optarg, "text") == 0) format = FORMAT_TEXT;
+            else if (strcmp(optarg, "csv") == 0) format = FORMAT_CSV;
+            else if (strcmp(optarg, "json") == 0) format = FORMAT_JSON;
+            else break;
+        } else break;
+        if (end && *end != '\0') break; // Trailing junk after a number
     }
+    if (opt != -1 || optind != argc || n < 1 || target < 0 || bucket < -1 || bucket > 52 || max_games < 1 || floor < 0 ||
+        first < 0 || every < 1 || (target > 0 && (first > 0 || checkpoint_path))) {
+        fprintf(stderr, "Usage: %s [-n games] [-s seed] [-t threads] [-o file | -] [-f text|csv|json]\n", argv[0]);
+        fprintf(stderr, "          [-e relative error [-c cards left | -p min probability] [-m max games]]\n");
+        fprintf(stderr, "          [-r first game] [-k checkpoint file [-b games per checkpoint]]\n");
+        fprintf(stderr, "  -n  number of games (default 10000), or the first batch with -e\n");
+        fprintf(stderr, "  -s  seed, for a repeatable run (default: from the clock)\n");
+        fprintf(stderr, "  -t  threads (default 0 = one per CPU); results don't depend on it\n");
+        fprintf(stderr, "  -o  output file (default phistogram.txt, - for stdout)\n");
+        fprintf(stderr, "  -f  output format (default text)\n");
+        fprintf(stderr, "  -e  play in batches until the 95%% interval of each bucket is within this\n");
+        fprintf(stderr, "      fraction of its estimate (e.g. 0.01)\n");
+        fprintf(stderr, "  -c  with -e, only require it of this bucket (e.g. 0 for P(0 cards left))\n");
+        fprintf(stderr, "  -p  with -e, ignore buckets rarer than this probability (default 0.001)\n");
+        fprintf(stderr, "  -m  with -e, never play more than this many games (default 100000000)\n");
+        fprintf(stderr, "  -r  index of the first game, to play one shard of a longer run (default 0)\n");
+        fprintf(stderr, "  -k  save progress to this shard file, and resume from it if it exists\n");
+        fprintf(stderr, "  -b  with -k, games between saves (default 1000000)\n");
+        return 1;
+    }
+    if (num_threads <= 0) num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) num_threads = 1;
 
-    // Save current stdout file descriptor
-    int saved_stdout = dup(fileno(stdout));
-    if (saved_stdout == -1) {
-        perror("dup failed");
-        exit(1);
+    // Pick up a checkpointed run where it stopped; a fresh one starts from nothing
+    Shard shard = {.seed = seed, .first = first, .games = n};
+    if (checkpoint_path) {
+        int found = shard_read(checkpoint_path, &shard);
+        if (found < 0) return 1;
+        if (found == 0 && (shard.first != first || shard.games != n || (seed_given && shard.seed != seed))) {
+            fprintf(stderr, "%s holds games %lld to %lld of seed %llu, not this run\n", checkpoint_path,
+                    shard.first, shard.first + shard.games - 1, (unsigned long long)shard.seed);
+            return 1;
+        }
+        if (found == 0) {
+            seed = shard.seed;
+            fprintf(stderr, "Resuming from %s: %lld of %lld games already done\n", checkpoint_path,
+                    shard.done, shard.games);
+        }
     }
 
-    // Redirect stdout to the file
-    FILE *fp = freopen("phistogram.txt", "w", stdout);
-    if (fp == NULL) {
-        perror("freopen failed");
-        exit(1);
+    // Open the output first, so a bad path fails before a long run rather than after
+    FILE *fptr = strcmp(output_path, "-") == 0 ? stdout : fopen(output_path, "w");
+    if (!fptr) {
+        perror("Error opening output file");
+        return 1;
     }
 
-    // Now histogram prints to phistogram.txt
-    histogram(labels, percentages, num_labels, 50);
-    fflush(stdout);
+    long long already = shard.done; // Games a resumed run doesn't play again
+    double t0 = now();
+    long long *matches;
+    if (target > 0) {
+        matches = plays_until_precise(n, max_games, target, bucket, floor, seed, num_threads, &n);
+    } else if (checkpoint_path) {
+        if (plays_with_checkpoints(&shard, checkpoint_path, every, num_threads) != 0) return 1;
+        matches = malloc(53 * sizeof(long long));
+        if (!matches) {
+            perror("Memory allocation failed");
+            return 1;
+        }
+        memcpy(matches, shard.left, 53 * sizeof(long long));
+    } else if (first > 0) {
+        matches = many_plays_range(first, n, seed, num_threads);
+    } else {
+        matches = many_plays_parallel(n, seed, num_threads);  // Simulate n silent games and get frequency of cards left
+    }
+    double elapsed = now() - t0;
+    fprintf(stderr, "%lld games, seed %llu, %d threads: %.3f s (%.0f games/s)\n",
+            n, (unsigned long long)seed, num_threads, elapsed, (n - already) / elapsed);
 
-    // Restore original stdout
-    if (dup2(saved_stdout, fileno(stdout)) == -1) {
-        perror("dup2 failed");
-        exit(1);
+    write_outcomes(fptr, format, matches, n, seed, num_threads);
+    int status = 0;
+    if (fptr != stdout ? fclose(fptr) != 0 : fflush(fptr) != 0) {
+        perror("Error writing output file");
+        status = 1;
     }
-    close(saved_stdout);
 
-    // Free allocated memory
-    free(labels);
-    free(percentages);
     free(matches);
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "patience.h"
+
+#define MAX_VALUES 32 // Most values in one list option
+
+/**
+ * Returns the current monotonic time in seconds, for timing the sweep.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Parses a comma-separated list of integers, like "9,10,11".
+ * @param text The list.
+ * @param values Array of MAX_VALUES to receive the integers.
+ * @param min Smallest value allowed.
+ * @param max Largest value allowed.
+ * @return Number of values, or -1 if the list is malformed or a value is out of range.
+ */
+static int parse_list(const char *text, int *values, int min, int max) {
+    int count = 0;
+    while (count < MAX_VALUES) {
+        char *end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value < min || value > max) return -1;
+        values[count++] = (int)value;
+        if (*end == '\0') return count;
+        if (*end != ',') return -1;
+        text = end + 1;
+    }
+    return -1;
+}
+
+/**
+ * Plays the same shuffled decks under every combination of the given pair targets,
+ * pile limits and J, Q, K settings, and writes one CSV row per combination: the
+ * rules, the mean number of cards left, then how many games left 0, 1, ..., 52.
+ */
+int main(int argc, char *argv[]) {
+    long long n = 100000;       // Number of decks
+    uint64_t seed = 1;
+    int num_threads = 0;        // 0 means one per CPU
+    const char *output_path = "-";
+    int targets[MAX_VALUES] = {11}, piles[MAX_VALUES] = {9}, jqks[MAX_VALUES] = {1};
+    int num_targets = 1, num_piles = 1, num_jqks = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:t:o:T:P:J:")) != -1) {
+        char *end = NULL;
+        if (opt == 'n') n = strtoll(optarg, &end, 10);
+        else if (opt == 's') seed = strtoull(optarg, &end, 10);
+        else if (opt == 't') num_threads = (int)strtol(optarg, &end, 10);
+        else if (opt == 'o') output_path = optarg;
+        else if (opt == 'T') num_targets = parse_list(optarg, targets, 2, 20);
+        else if (opt == 'P') num_piles = parse_list(optarg, piles, 2, RULES_MAX_PILES);
+        else if (opt == 'J') num_jqks = parse_list(optarg, jqks, 0, 1);
+        else break;
+        if ((end && *end != '\0') || num_targets < 0 || num_piles < 0 || num_jqks < 0) break;
+    }
+    if (opt != -1 || optind != argc || n < 1) {
+        fprintf(stderr, "Usage: %s [-n decks] [-s seed] [-t threads] [-o file | -] [-T targets] [-P piles] [-J 0,1]\n", argv[0]);
+        fprintf(stderr, "  -n  number of decks, each played under every rule set (default 100000)\n");
+        fprintf(stderr, "  -s  seed (default 1)\n");
+        fprintf(stderr, "  -t  threads (default 0 = one per CPU)\n");
+        fprintf(stderr, "  -o  output CSV file (default - for stdout)\n");
+        fprintf(stderr, "  -T  pair targets to try, 2 to 20, e.g. 10,11,12 (default 11)\n");
+        fprintf(stderr, "  -P  pile limits to try, 2 to %d, e.g. 8,9,10 (default 9)\n", RULES_MAX_PILES);
+        fprintf(stderr, "  -J  whether J, Q, K are covered: 1, 0 or 0,1 (default 1)\n");
+        return 1;
+    }
+
+    int num_rules = num_targets * num_piles * num_jqks;
+    Rules *rules = malloc(num_rules * sizeof(Rules));
+    if (!rules) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    int r = 0;
+    for (int i = 0; i < num_targets; i++) {
+        for (int j = 0; j < num_piles; j++) {
+            for (int k = 0; k < num_jqks; k++, r++) {
+                rules[r].target = targets[i];
+                rules[r].max_piles = piles[j];
+                rules[r].jqk = jqks[k];
+            }
+        }
+    }
+
+    // Open the output first, so a bad path fails before a long run rather than after
+    FILE *fptr = strcmp(output_path, "-") == 0 ? stdout : fopen(output_path, "w");
+    if (!fptr) {
+        perror("Error opening output file");
+        free(rules);
+        return 1;
+    }
+
+    double t0 = now();
+    long long *remaining = sweep_plays(n, seed, num_threads, rules, num_rules);
+    double elapsed = now() - t0;
+    fprintf(stderr, "%lld decks x %d rule sets, seed %llu: %.3f s (%.0f games/s)\n", n, num_rules,
+            (unsigned long long)seed, elapsed, n * num_rules / elapsed);
+
+    fprintf(fptr, "target,max_piles,jqk,mean_cards_left");
+    for (int k = 0; k < 53; k++) fprintf(fptr, ",left_%d", k);
+    fprintf(fptr, "\n");
+    for (r = 0; r < num_rules; r++) {
+        const long long *counts = remaining + r * 53;
+        double sum = 0;
+        for (int k = 0; k < 53; k++) sum += (double)k * counts[k];
+        fprintf(fptr, "%d,%d,%d,%.4f", rules[r].target, rules[r].max_piles, rules[r].jqk, sum / n);
+        for (int k = 0; k < 53; k++) fprintf(fptr, ",%lld", counts[k]);
+        fprintf(fptr, "\n");
+    }
+    int status = 0;
+    if (fptr != stdout ? fclose(fptr) != 0 : fflush(fptr) != 0) {
+        perror("Error writing output file");
+        status = 1;
+    }
+    free(remaining);
+    free(rules);
+    return status;
+}
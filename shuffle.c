@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
+#include "shuffle.h"
 
 /*
  * Structure to hold a value to be shuffled and a random value that on which the values 
@@ -63,3 +65,165 @@ void shuffle(int *x, int n, int seed)
         x[j] = pairs[j].value;
     return;
 }
+
+uint64_t splitmix64(uint64_t *state)
+{
+    /*
+     * Return the next number from a splitmix64 stream and advance its state.
+     *
+     * Parameters
+     * ----------
+     *
+     * state : the stream's 64-bit state. Each caller owns its own, so threads can
+     *         draw numbers without sharing anything.
+     */
+
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t game_seed(uint64_t seed, uint64_t index)
+{
+    /*
+     * Derive the random number stream of one game in a run from the run's seed and
+     * the game's index, so a game is shuffled the same way whichever thread plays
+     * it and whatever else runs before it.
+     *
+     * Parameters
+     * ----------
+     *
+     * seed : seed for the whole run
+     *
+     * index : position of the game in the run (0, 1, 2, ...)
+     */
+
+    uint64_t state = seed ^ (index * 0xD1B54A32D192ED03ull);
+    splitmix64(&state);
+    return splitmix64(&state);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    /*
+     * Initialise a xoshiro256** generator from a 64-bit seed. The four state words
+     * come from a splitmix64 stream, which never gives the all-zero state.
+     *
+     * Parameters
+     * ----------
+     *
+     * rng : generator to initialise
+     *
+     * seed : any 64-bit value (e.g. from game_seed)
+     */
+
+    uint64_t state = seed;
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = splitmix64(&state);
+}
+
+uint64_t rng_next(Rng *rng)
+{
+    /*
+     * Return the next 64-bit number from a xoshiro256** generator.
+     */
+
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+static inline uint32_t bounded(Rng *rng, uint32_t x, uint32_t bound)
+{
+    /*
+     * Map the 32-bit random number x to [0, bound) without bias (Lemire's method):
+     * take the top half of x * bound, and in the rare case the bottom half lands in
+     * the short first stretch, draw again from rng until it doesn't.
+     */
+
+    uint64_t m = (uint64_t)x * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound) {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold) {
+            m = (uint64_t)(uint32_t)(rng_next(rng) >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+uint32_t rng_bounded(Rng *rng, uint32_t bound)
+{
+    /*
+     * Return a uniformly distributed integer in [0, bound), for bound > 0.
+     */
+
+    return bounded(rng, (uint32_t)(rng_next(rng) >> 32), bound);
+}
+
+void shuffle_fy(int *x, int n, Rng *rng)
+{
+    /*
+     * Shuffle the n elements of the integer array x in place with a Fisher-Yates
+     * pass: every ordering is equally likely, and it takes n - 1 swaps instead of a
+     * sort. Each 64-bit number from the generator is split into two 32-bit draws.
+     *
+     * Parameters
+     * ----------
+     *
+     * x : array of integers to be shuffled
+     *
+     * n : length of x
+     *
+     * rng : generator to draw from (see rng_seed), advanced in place
+     */
+
+    int j = n - 1;
+    while (j > 0) {
+        uint64_t r = rng_next(rng);
+        int k = bounded(rng, (uint32_t)(r >> 32), (uint32_t)j + 1);
+        int tmp = x[j]; x[j] = x[k]; x[k] = tmp;
+        j--;
+        if (j > 0) {
+            k = bounded(rng, (uint32_t)r, (uint32_t)j + 1);
+            tmp = x[j]; x[j] = x[k]; x[k] = tmp;
+            j--;
+        }
+    }
+}
+
+void shuffle_batch(int *x, int n, int count, Rng *rng)
+{
+    /*
+     * Shuffle count arrays of n integers stored one after another (e.g. a block of
+     * decks), each with its own Fisher-Yates pass, from one generator.
+     *
+     * Parameters
+     * ----------
+     *
+     * x : count * n integers; array i starts at x + i * n
+     *
+     * n : length of each array
+     *
+     * count : number of arrays
+     *
+     * rng : generator to draw from, advanced in place
+     */
+
+    for (int i = 0; i < count; i++)
+        shuffle_fy(x + (size_t)i * n, n, rng);
+}
@@ -1,6 +1,20 @@
 #if !defined(SHUFFLE_H)
 #define SHUFFLE_H
 
+#include <stdint.h>
+
+/* State of a xoshiro256** generator */
+typedef struct Rng {
+    uint64_t s[4];
+} Rng;
+
 void shuffle(int *, int, int);
+uint64_t splitmix64(uint64_t *);
+uint64_t game_seed(uint64_t, uint64_t);
+void rng_seed(Rng *, uint64_t);
+uint64_t rng_next(Rng *);
+uint32_t rng_bounded(Rng *, uint32_t);
+void shuffle_fy(int *, int, Rng *);
+void shuffle_batch(int *, int, int, Rng *);
 
 #endif
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "patience.h"
+#include "trace.h"
+
+/**
+ * Sets up a trace sink. Binary and compact sinks get a write buffer and write the
+ * file header straight away; the other kinds need nothing.
+ * @param sink The sink to set up.
+ * @param kind TRACE_NONE, TRACE_TEXT, TRACE_BINARY or TRACE_COMPACT.
+ * @param out Stream to write to (ignored for TRACE_NONE).
+ * @param verbose For text traces, 1 to annotate each board with the move.
+ * @return 0 on success, -1 if memory allocation or writing the header fails.
+ */
+int trace_open(TraceSink *sink, TraceKind kind, FILE *out, int verbose) {
+    memset(sink, 0, sizeof(*sink));
+    sink->kind = kind;
+    sink->out = out;
+    sink->verbose = verbose;
+    if (kind != TRACE_BINARY && kind != TRACE_COMPACT) return 0;
+
+    sink->buffer = malloc(TRACE_BUFFER_SIZE);
+    if (!sink->buffer) {
+        perror("Memory allocation failed for trace buffer");
+        return -1;
+    }
+    TraceHeader header = {{0}, TRACE_VERSION, sizeof(TraceRecord)};
+    if (kind == TRACE_COMPACT) header.version = TRACE_COMPACT_VERSION, header.record_size = 1;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, out) != 1) {
+        perror("Error writing trace");
+        free(sink->buffer);
+        sink->buffer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Writes out the binary records held in a sink's buffer.
+ * @param sink The sink.
+ */
+static void flush_records(TraceSink *sink) {
+    if (sink->used && fwrite(sink->buffer, 1, sink->used, sink->out) != sink->used && !sink->failed) {
+        perror("Error writing trace");
+        sink->failed = 1;
+    }
+    sink->used = 0;
+}
+
+/**
+ * Appends one binary record describing a board and the move about to be made on it.
+ * @param sink The sink.
+ * @param board The board before the move.
+ * @param deck The deck before the move.
+ * @param move The move.
+ * @param piles Piles the move covers, in covering order.
+ * @param count Number of piles covered.
+ */
+static void write_record(TraceSink *sink, const Board *board, const Deck *deck, Move move,
+                         const int *piles, int count) {
+    if (sink->used + sizeof(TraceRecord) > TRACE_BUFFER_SIZE) flush_records(sink);
+    TraceRecord *r = (TraceRecord *)(sink->buffer + sink->used);
+    memset(r, 0, sizeof(*r));
+    r->move = move;
+    r->cards_drawn = deck->top;
+    r->num_piles = board->num_piles;
+    r->num_covered = count;
+    for (int p = 0; p < board->num_piles; p++) r->tops[p] = board->tops[p];
+    for (int i = 0; i < count; i++) r->covered[i] = piles[i];
+
+    // Covering stops when the deck runs out; a new pile takes one card
+    int dealt = move == MOVE_NEW_PILE ? 1 : move == MOVE_NONE ? 0 : count;
+    if (dealt > 52 - deck->top) dealt = 52 - deck->top;
+    r->num_dealt = dealt;
+    for (int i = 0; i < dealt; i++) r->dealt[i] = deck->cards[deck->top + i];
+    sink->used += sizeof(TraceRecord);
+}
+
+/**
+ * Appends compact trace bytes, first the game's deck if this is its first move.
+ * @param sink The sink.
+ * @param deck The deck (its cards are all still in drawing order).
+ * @param byte The move byte.
+ */
+static void write_compact(TraceSink *sink, const Deck *deck, uint8_t byte) {
+    if (sink->used + 52 + 1 > TRACE_BUFFER_SIZE) flush_records(sink);
+    if (!sink->in_game) {
+        for (int i = 0; i < 52; i++) sink->buffer[sink->used++] = (unsigned char)deck->cards[i];
+        sink->in_game = 1;
+    }
+    sink->buffer[sink->used++] = byte;
+    if (byte == 0) sink->in_game = 0; // Game over: the next byte is another deck
+}
+
+/**
+ * Prints a board in the text trace format, with an optional annotation.
+ * Each card takes up 3 spaces for neat alignment. If verbose mode is on, the
+ * annotation appears starting at column 30 for readability.
+ * @param sink The sink (stream and verbose setting).
+ * @param board The board to print.
+ * @param action Annotation to show (ignored if empty or verbose is off).
+ */
+static void print_board(TraceSink *sink, const Board *board, const char *action) {
+    int col = 0;
+    for (int p = 0; p < board->num_piles; p++) {
+        col += fprintf(sink->out, "%3d", board->tops[p]); // Print each card, track column width
+    }
+    if (sink->verbose && action[0] != '\0') {
+        int padding = (30 - col) < 1 ? 1 : (30 - col); // Ensure at least 1 space before annotation
+        fprintf(sink->out, "%*s%s", padding, "", action);
+    }
+    fputc('\n', sink->out);
+}
+
+/**
+ * Records a move just before it is made.
+ * Text traces print the board with a note about the move, as play() always has;
+ * binary traces append a record.
+ * @param sink The sink.
+ * @param board The board before the move.
+ * @param deck The deck before the move.
+ * @param move The move (from board_find_move).
+ * @param piles Piles the move covers, in covering order.
+ * @param count Number of piles covered.
+ */
+void trace_move(TraceSink *sink, const Board *board, const Deck *deck, Move move,
+                const int *piles, int count) {
+    if (sink->kind == TRACE_BINARY) {
+        write_record(sink, board, deck, move, piles, count);
+        return;
+    }
+    if (sink->kind == TRACE_COMPACT) {
+        write_compact(sink, deck, TRACE_MOVE_BYTE(move, count));
+        return;
+    }
+    if (sink->kind != TRACE_TEXT) return;
+
+    char annotation[256] = ""; // Buffer for move descriptions
+    if (sink->verbose) {
+        const int *next = deck->cards + deck->top;
+        int available = 52 - deck->top;
+        if (move == MOVE_PAIRS) { // Note about the first pair
+            int v1 = board->tops[piles[0]], v2 = board->tops[piles[1]];
+            if (available < 2) {
+                snprintf(annotation, sizeof(annotation), "%d and %d add to 11, but %s",
+                         v1, v2, available ? "only 1 card left" : "no cards left");
+            } else {
+                snprintf(annotation, sizeof(annotation), "%d and %d add to 11; will cover with %d and %d",
+                         v1, v2, next[0], next[1]);
+            }
+        } else if (move == MOVE_JQK) { // Note about JQK removal
+            if (available < 3) {
+                snprintf(annotation, sizeof(annotation), "J, Q, K visible, but %s",
+                         available ? "not enough cards" : "no cards left");
+            } else {
+                snprintf(annotation, sizeof(annotation), "J, Q, K visible; will cover with %d, %d, %d",
+                         next[0], next[1], next[2]);
+            }
+        } else if (move == MOVE_NEW_PILE) {
+            snprintf(annotation, sizeof(annotation), "Cards don't add to 11; will start a new pile with %d", next[0]);
+        }
+    }
+    print_board(sink, board, annotation);
+}
+
+/**
+ * Records the end of a game.
+ * Text traces show the final board (when verbose) and a blank line; binary traces
+ * append a MOVE_NONE record holding the final board, and compact traces a 0 byte.
+ * @param sink The sink.
+ * @param board The final board.
+ * @param deck The deck at the end of the game.
+ */
+void trace_end(TraceSink *sink, const Board *board, const Deck *deck) {
+    if (sink->kind == TRACE_BINARY) {
+        write_record(sink, board, deck, MOVE_NONE, NULL, 0);
+        return;
+    }
+    if (sink->kind == TRACE_COMPACT) {
+        write_compact(sink, deck, 0);
+        return;
+    }
+    if (sink->kind != TRACE_TEXT) return;
+    if (sink->verbose) {
+        print_board(sink, board, board->num_piles == 9 ? "Game ended with 9 piles"
+                                                       : "Game ended with no cards left in deck");
+    }
+    fputc('\n', sink->out);
+}
+
+/**
+ * Finishes a trace: writes out any buffered records and frees the buffer.
+ * The stream itself is left open for the caller to close.
+ * @param sink The sink.
+ * @return 0 on success, -1 if any write failed.
+ */
+int trace_close(TraceSink *sink) {
+    if ((sink->kind == TRACE_BINARY || sink->kind == TRACE_COMPACT) && sink->buffer) {
+        flush_records(sink);
+        free(sink->buffer);
+        sink->buffer = NULL;
+    }
+    if (sink->kind != TRACE_NONE && fflush(sink->out) != 0) sink->failed = 1;
+    return sink->failed ? -1 : 0;
+}
+
+/**
+ * Reads and checks the header of a binary or compact trace.
+ * @param in Stream to read from.
+ * @param version Receives TRACE_VERSION or TRACE_COMPACT_VERSION.
+ * @return 0 on success, -1 if the stream does not start with a trace header.
+ */
+int trace_read_header(FILE *in, uint32_t *version) {
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        !((header.version == TRACE_VERSION && header.record_size == sizeof(TraceRecord)) ||
+          (header.version == TRACE_COMPACT_VERSION && header.record_size == 1))) {
+        return -1;
+    }
+    *version = header.version;
+    return 0;
+}
+
+/**
+ * Reads the next game of a compact trace.
+ * @param in Stream to read from, just after the header or the previous game.
+ * @param game Receives the game.
+ * @return 1 if a game was read, 0 at the end of the trace, -1 if it is cut short
+ *         or holds something other than card values and moves.
+ */
+int trace_read_game(FILE *in, TraceGame *game) {
+    unsigned char cards[52];
+    size_t got = fread(cards, 1, 52, in);
+    if (got == 0 && feof(in)) return 0;
+    if (got != 52) return -1;
+    for (int i = 0; i < 52; i++) {
+        if (cards[i] < 1 || cards[i] > 13) return -1;
+        game->deck.cards[i] = cards[i];
+    }
+    game->deck.top = 0;
+    for (game->num_moves = 0; game->num_moves < TRACE_MAX_MOVES; game->num_moves++) {
+        int byte = fgetc(in);
+        if (byte == EOF) return -1;
+        game->moves[game->num_moves] = (uint8_t)byte;
+        if (byte == 0) return 1;
+    }
+    return -1;
+}
+
+/**
+ * Plays a game read back from a compact trace, sending each board to a sink (a text
+ * sink renders it exactly as play() would have), and checks every move made against
+ * the one recorded.
+ * @param game The game.
+ * @param sink Where to send the moves (NULL for nowhere).
+ * @return Number of cards left at the end, or -1 if the moves differ from the
+ *         recording (a damaged trace, or one made under other rules).
+ */
+int trace_replay(const TraceGame *game, TraceSink *sink) {
+    Deck deck = game->deck;
+    Board board;
+    board_init(&board, &deck);
+    for (int i = 0; ; i++) {
+        int piles[18], count;
+        Move move = board_find_move(&board, &deck, piles, &count);
+        if (i > game->num_moves || game->moves[i] != TRACE_MOVE_BYTE(move, count)) return -1;
+        if (move == MOVE_NONE) break;
+        if (sink) trace_move(sink, &board, &deck, move, piles, count);
+        board_apply(&board, &deck, move, piles, count);
+    }
+    if (sink) trace_end(sink, &board, &deck);
+    return 52 - deck.top;
+}
@@ -0,0 +1,81 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "patience.h"
+
+#define TRACE_MAGIC "PTRACE\0\0"
+#define TRACE_VERSION 1
+#define TRACE_COMPACT_VERSION 2
+#define TRACE_BUFFER_SIZE (64 * 1024) // Bytes of binary records held before writing
+#define TRACE_MAX_MOVES 64            // More than any game makes (each move draws a card)
+
+// Where the moves of a game go.
+typedef enum TraceKind {
+    TRACE_NONE,     // Nowhere: games run silently
+    TRACE_TEXT,     // Printed boards, exactly as play() has always shown them
+    TRACE_BINARY,   // Fixed-size TraceRecords after a TraceHeader
+    TRACE_COMPACT   // Each game's deck and a byte per move after a TraceHeader
+} TraceKind;
+
+struct TraceSink {
+    TraceKind kind;
+    FILE *out;              // Stream the trace is written to
+    int verbose;            // Text: annotate each board with the move
+    unsigned char *buffer;  // Binary: records not yet written
+    size_t used;            // Binary: bytes in buffer
+    int failed;             // Set if a write failed
+    int in_game;            // Compact: the current game's deck has been written
+};
+
+/*
+ * Binary trace format: a TraceHeader, then one TraceRecord per move. Each game is a
+ * run of records ending with a MOVE_NONE record holding its final board. Records
+ * hold card values, not pointers, so a log can be read back by any program.
+ */
+typedef struct TraceHeader {
+    char magic[8];          // TRACE_MAGIC
+    uint32_t version;       // TRACE_VERSION
+    uint32_t record_size;   // sizeof(TraceRecord)
+} TraceHeader;
+
+/*
+ * Compact trace format (version 2): a TraceHeader with record_size 1, then per game
+ * the 52 card values of its shuffled deck in drawing order, then one byte per move
+ * made (TRACE_MOVE_BYTE), ending with a 0 byte (MOVE_NONE). The deck alone decides
+ * the game, so the boards are not stored: trace_replay plays them back, checking
+ * each move against the byte recorded. A game takes about 64 bytes.
+ */
+#define TRACE_MOVE_BYTE(move, count) ((uint8_t)((move) | (count) << 2))
+#define TRACE_BYTE_MOVE(byte) ((Move)((byte) & 3))
+#define TRACE_BYTE_COUNT(byte) ((byte) >> 2)
+
+// One game read back from a compact trace
+typedef struct TraceGame {
+    Deck deck;                      // The deck as shuffled (top is 0)
+    uint8_t moves[TRACE_MAX_MOVES]; // TRACE_MOVE_BYTEs, the last one 0
+    int num_moves;                  // Moves before the final 0 byte
+} TraceGame;
+
+typedef struct TraceRecord {
+    uint8_t move;           // Move made (MOVE_NONE for the final board of a game)
+    uint8_t cards_drawn;    // Cards drawn from the deck before the move
+    uint8_t num_piles;      // Piles showing before the move
+    uint8_t num_covered;    // Piles the move covers (pairs or J, Q, K)
+    uint8_t num_dealt;      // Cards the move takes from the deck
+    uint8_t tops[9];        // Top card of each pile before the move
+    uint8_t covered[8];     // Indices of the covered piles, in covering order
+    uint8_t dealt[8];       // Cards the move takes from the deck, in order
+    uint8_t reserved[2];    // Keeps records 32 bytes
+} TraceRecord;
+
+int trace_open(TraceSink *sink, TraceKind kind, FILE *out, int verbose);
+void trace_move(TraceSink *sink, const Board *board, const Deck *deck, Move move, const int *piles, int count);
+void trace_end(TraceSink *sink, const Board *board, const Deck *deck);
+int trace_close(TraceSink *sink);
+int trace_read_header(FILE *in, uint32_t *version);
+int trace_read_game(FILE *in, TraceGame *game);
+int trace_replay(const TraceGame *game, TraceSink *sink);
+
+#endif
@@ -1,9 +1,44 @@
 #define _POSIX_C_SOURCE 200809L
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "utils.h"
 
+/*
+ * Newline scanning works on blocks of SCAN_WIDTH bytes at a time: newline_mask returns
+ * a bitmask with bit i set when p[i] is '\n'. AVX2 and SSE2 versions are picked at
+ * compile time (SSE2 is always there on x86-64; build with -mavx2 or -march=native
+ * for AVX2); anything else gets a plain byte loop.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_WIDTH 32
+static inline uint32_t newline_mask(const char *p) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_WIDTH 16
+static inline uint32_t newline_mask(const char *p) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+}
+#else
+#define SCAN_WIDTH 8
+static inline uint32_t newline_mask(const char *p) {
+    uint32_t mask = 0;
+    for (int i = 0; i < SCAN_WIDTH; i++) mask |= (uint32_t)(p[i] == '\n') << i;
+    return mask;
+}
+#endif
+
 /**
  * Checks if a number exists in an array.
  * Loops through the array and returns true (1) if the number is found, false (0) if not.
@@ -126,4 +161,339 @@ void free_words(char **words, int size) {
         for (int i = 0; i < size; i++) free(words[i]); // Free each string
         free(words); // Free the array of pointers
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Counts the lines in a block of text, the way fgets would: every newline ends a
+ * line, plus one more if the text doesn't end with a newline.
+ * Scans SCAN_WIDTH bytes per step with the vectorized newline_mask.
+ * @param text Start of the text.
+ * @param size Number of bytes.
+ * @return Number of lines.
+ */
+long count_lines(const char *text, size_t size) {
+    size_t i = 0;
+    long count = 0;
+    for (; i + SCAN_WIDTH <= size; i += SCAN_WIDTH)
+        count += __builtin_popcount(newline_mask(text + i));
+    for (; i < size; i++) count += text[i] == '\n'; // Leftover tail
+    if (size > 0 && text[size - 1] != '\n') count++; // Last line without a newline
+    return count;
+}
+
+/**
+ * Checks that a list's line count fits the int counts word lists are kept in.
+ * @param count Number of lines (from count_lines).
+ * @param name Name of the list, for the error message.
+ * @return 1 if it fits, 0 (with a message on stderr) if not.
+ */
+static int count_fits(long count, const char *name) {
+    if (count <= INT_MAX) return 1;
+    fprintf(stderr, "Error: %s has %ld lines, more than the %d a word list can hold\n", name, count, INT_MAX);
+    return 0;
+}
+
+// Position of a scan for line ends through a block of text (see next_line)
+typedef struct lineScan {
+    const char *text;
+    size_t size;
+    size_t start;           // Where the next line starts
+    size_t block;           // Start of the block mask covers
+    size_t next;            // Next byte not yet scanned
+    uint32_t mask;          // Newlines of the block not yet reported
+} lineScan;
+
+/**
+ * Finds the next line of a block of text. Newlines are found SCAN_WIDTH bytes at a
+ * time; each set bit of the mask ends a line. The last line needn't end in a newline.
+ * @param scan The scan (start one zeroed, with text and size set).
+ * @param start Receives the offset of the line's first character.
+ * @param len Receives the line's length, without the newline.
+ * @return 1 if there was another line, 0 at the end of the text.
+ */
+static int next_line(lineScan *scan, size_t *start, size_t *len) {
+    size_t nl;
+    while (1) {
+        if (scan->mask) { // A newline left in the current block
+            nl = scan->block + __builtin_ctz(scan->mask);
+            scan->mask &= scan->mask - 1;
+            break;
+        }
+        if (scan->next + SCAN_WIDTH <= scan->size) {
+            scan->block = scan->next;
+            scan->mask = newline_mask(scan->text + scan->next);
+            scan->next += SCAN_WIDTH;
+        } else if (scan->next < scan->size) { // Leftover tail
+            if (scan->text[scan->next++] == '\n') {
+                nl = scan->next - 1;
+                break;
+            }
+        } else if (scan->start < scan->size) { // Last line without a newline
+            *start = scan->start;
+            *len = scan->size - scan->start;
+            scan->start = scan->size;
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+    *start = scan->start;
+    *len = nl - scan->start;
+    scan->start = nl + 1;
+    return 1;
+}
+
+/**
+ * Fills in one view per line of a block of text, without copying or changing it.
+ * @param text Start of the text.
+ * @param size Number of bytes.
+ * @param views Array to fill, with room for count views.
+ * @param count Number of lines (from count_lines).
+ */
+void split_lines(char *text, size_t size, wordView *views, int count) {
+    lineScan scan = {text, size, 0, 0, 0, 0};
+    size_t start, len;
+    for (int line = 0; line < count && next_line(&scan, &start, &len); line++) {
+        views[line].str = text + start;
+        views[line].len = (int)len;
+    }
+}
+
+/**
+ * Fills in one read-only view per line of a block of text, as split_lines does.
+ * @param text Start of the text.
+ * @param size Number of bytes.
+ * @param views Array to fill, with room for count views.
+ * @param count Number of lines (from count_lines).
+ */
+void split_mapped_lines(const char *text, size_t size, mappedView *views, int count) {
+    lineScan scan = {text, size, 0, 0, 0, 0};
+    size_t start, len;
+    for (int line = 0; line < count && next_line(&scan, &start, &len); line++) {
+        views[line].str = text + start;
+        views[line].len = (int)len;
+    }
+}
+
+/**
+ * Loads a whole word list with one bulk read into a single arena.
+ * The file's bytes are read straight into the arena behind a wordList header, lines
+ * are split in place (each newline becomes a NUL) and an array of views is filled in
+ * along the way. There is no per-line allocation and no line-length limit, and
+ * free_word_list releases everything with one free.
+ * @param file_path Path to the text file (one word per line).
+ * @return The loaded list, or NULL if the file can't be read or is empty.
+ */
+wordList *load_word_list(const char *file_path) {
+    FILE *fptr = fopen(file_path, "rb");
+    if (!fptr) {
+        perror("Error opening file");
+        return NULL;
+    }
+    long file_size = -1;
+    if (fseek(fptr, 0, SEEK_END) == 0) file_size = ftell(fptr);
+    if (file_size < 0 || fseek(fptr, 0, SEEK_SET) != 0) {
+        perror("Error sizing file");
+        fclose(fptr);
+        return NULL;
+    }
+    if (file_size == 0) {
+        fprintf(stderr, "Error: File is empty or invalid size.\n");
+        fclose(fptr);
+        return NULL;
+    }
+
+    // Header, then the text (plus a NUL for a last line without a newline)
+    size_t text_offset = (sizeof(wordList) + 7) & ~(size_t)7;
+    size_t text_size = ((size_t)file_size + 1 + 7) & ~(size_t)7;
+    char *arena = malloc(text_offset + text_size);
+    if (!arena) {
+        perror("Memory allocation failed");
+        fclose(fptr);
+        return NULL;
+    }
+    char *text = arena + text_offset;
+    size_t got = fread(text, 1, file_size, fptr);
+    fclose(fptr);
+    if (got != (size_t)file_size) {
+        fprintf(stderr, "Error: Could not read %s\n", file_path);
+        free(arena);
+        return NULL;
+    }
+
+    // Count lines so the views can go in the same arena, right after the text
+    long lines = count_lines(text, file_size);
+    if (!count_fits(lines, file_path)) {
+        free(arena);
+        return NULL;
+    }
+    int count = (int)lines;
+    char *grown = realloc(arena, text_offset + text_size + (size_t)count * sizeof(wordView));
+    if (!grown) {
+        perror("Memory allocation failed");
+        free(arena);
+        return NULL;
+    }
+    arena = grown;
+    text = arena + text_offset;
+
+    wordList *list = (wordList *)arena;
+    list->words = (wordView *)(text + text_size);
+    list->count = count;
+    list->size = file_size;
+
+    // Split the lines, then terminate each one where its newline was
+    split_lines(text, file_size, list->words, count);
+    for (int i = 0; i < count; i++) list->words[i].str[list->words[i].len] = '\0';
+    return list;
+}
+
+/**
+ * Reads a word list from an open stream (e.g., standard input) until end of file.
+ * Pipes can't be sized up front, so the arena grows as data arrives; after that the
+ * list is laid out and split exactly like load_word_list's, and freed the same way.
+ * @param fptr Stream to read.
+ * @return The loaded list, or NULL if reading fails or the stream is empty.
+ */
+wordList *read_word_list(FILE *fptr) {
+    size_t text_offset = (sizeof(wordList) + 7) & ~(size_t)7;
+    size_t capacity = 64 * 1024, size = 0, got;
+    char *arena = malloc(text_offset + capacity);
+    if (!arena) {
+        perror("Memory allocation failed");
+        return NULL;
+    }
+    while ((got = fread(arena + text_offset + size, 1, capacity - size, fptr)) > 0) {
+        size += got;
+        if (size == capacity) {
+            char *grown = realloc(arena, text_offset + capacity * 2);
+            if (!grown) {
+                perror("Memory allocation failed");
+                free(arena);
+                return NULL;
+            }
+            arena = grown;
+            capacity *= 2;
+        }
+    }
+    if (ferror(fptr) || size == 0) {
+        if (ferror(fptr)) perror("Error reading input");
+        else fprintf(stderr, "Error: Input is empty.\n");
+        free(arena);
+        return NULL;
+    }
+
+    // Room for the text plus a NUL, then the views, as in load_word_list
+    size_t text_size = (size + 1 + 7) & ~(size_t)7;
+    long lines = count_lines(arena + text_offset, size);
+    if (!count_fits(lines, "Input")) {
+        free(arena);
+        return NULL;
+    }
+    int count = (int)lines;
+    char *grown = realloc(arena, text_offset + text_size + (size_t)count * sizeof(wordView));
+    if (!grown) {
+        perror("Memory allocation failed");
+        free(arena);
+        return NULL;
+    }
+    arena = grown;
+    char *text = arena + text_offset;
+    wordList *list = (wordList *)arena;
+    list->words = (wordView *)(text + text_size);
+    list->count = count;
+    list->size = size;
+    split_lines(text, size, list->words, count);
+    for (int i = 0; i < count; i++) list->words[i].str[list->words[i].len] = '\0';
+    return list;
+}
+
+/**
+ * Maps a whole file read-only and shared, for reading it in place.
+ * @param file_path Path to the file.
+ * @param size Pointer to store the file's size in bytes.
+ * @return Start of the mapping, or NULL if the file can't be mapped or is empty.
+ */
+char *map_file(const char *file_path, size_t *size) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Error: File is empty or invalid size.\n");
+        close(fd);
+        return NULL;
+    }
+    char *text = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (text == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    posix_madvise(text, st.st_size, POSIX_MADV_SEQUENTIAL); // Just a hint for read-ahead
+    *size = st.st_size;
+    return text;
+}
+
+/**
+ * Releases a mapping made by map_file.
+ * @param text Start of the mapping.
+ * @param size Size passed back by map_file.
+ */
+void unmap_file(char *text, size_t size) {
+    if (text) munmap(text, size);
+}
+
+/**
+ * Maps a word list or corpus read-only and indexes its lines without copying them.
+ * The views point straight into the mapping (they are read-only and not
+ * NUL-terminated), so the only memory used besides the page cache is one view per
+ * line. This is the mode for huge word dumps that shouldn't be duplicated on the heap.
+ * @param file_path Path to the text file (one word per line).
+ * @return The mapped list, or NULL if the file can't be mapped or is empty.
+ */
+mappedWordList *map_word_list(const char *file_path) {
+    size_t size;
+    char *text = map_file(file_path, &size);
+    if (!text) return NULL;
+
+    long lines = count_lines(text, size);
+    if (!count_fits(lines, file_path)) {
+        unmap_file(text, size);
+        return NULL;
+    }
+    int count = (int)lines;
+    size_t views_offset = (sizeof(mappedWordList) + 7) & ~(size_t)7;
+    char *block = malloc(views_offset + (size_t)count * sizeof(mappedView));
+    if (!block) {
+        perror("Memory allocation failed");
+        unmap_file(text, size);
+        return NULL;
+    }
+    mappedWordList *list = (mappedWordList *)block;
+    list->words = (mappedView *)(block + views_offset);
+    list->count = count;
+    list->size = size;
+    list->mapping = text;
+    split_mapped_lines(text, size, list->words, count);
+    return list;
+}
+
+/**
+ * Frees a word list from load_word_list or read_word_list (one allocation).
+ * @param list The list to free (may be NULL).
+ */
+void free_word_list(wordList *list) {
+    free(list);
+}
+
+/**
+ * Frees a word list from map_word_list: the views, then the mapping.
+ * @param list The list to free (may be NULL).
+ */
+void free_mapped_word_list(mappedWordList *list) {
+    if (list) unmap_file(list->mapping, list->size);
+    free(list);
+}
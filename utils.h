@@ -4,11 +4,61 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/*
+ * A view of one line of a word list loaded into memory (load_word_list): a pointer
+ * into the list's text and the line's length. The line is NUL-terminated in place.
+ */
+typedef struct wordView {
+    char *str;     // First character of the line
+    int len;       // Length of the line, without the newline
+} wordView;
+
+/*
+ * A view of one line of a mapped word list (map_word_list). It points into a
+ * read-only mapping, so it is const, and it is not NUL-terminated.
+ */
+typedef struct mappedView {
+    const char *str; // First character of the line
+    int len;         // Length of the line, without the newline
+} mappedView;
+
+/*
+ * A whole word list from load_word_list or read_word_list: one allocation holding
+ * this header, the file's bytes (split into lines in place) and the array of views,
+ * released by free_word_list.
+ */
+typedef struct wordList {
+    wordView *words;   // One view per line
+    int count;         // Number of lines
+    size_t size;       // Size of the file in bytes
+} wordList;
+
+/*
+ * A whole word list from map_word_list: this header and the views, over an mmap of
+ * the file, released by free_mapped_word_list.
+ */
+typedef struct mappedWordList {
+    mappedView *words; // One view per line
+    int count;         // Number of lines
+    size_t size;       // Size of the file in bytes
+    char *mapping;     // Start of the mmap'd file
+} mappedWordList;
+
 int contains(int *x, int num, int n);
 int get_index(int *x, int num, int n);
 int get_file_size(const char *file_path);
 int *get_indexes(double *H, int size);
 char **read_txt_file(const char *file_path, int size);
 void free_words(char **words, int size);
+wordList *load_word_list(const char *file_path);
+wordList *read_word_list(FILE *fptr);
+mappedWordList *map_word_list(const char *file_path);
+char *map_file(const char *file_path, size_t *size);
+void unmap_file(char *text, size_t size);
+long count_lines(const char *text, size_t size);
+void split_lines(char *text, size_t size, wordView *views, int count);
+void split_mapped_lines(const char *text, size_t size, mappedView *views, int count);
+void free_word_list(wordList *list);
+void free_mapped_word_list(mappedWordList *list);
 
 #endif 
\ No newline at end of file
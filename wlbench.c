@@ -0,0 +1,88 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "histogram.h"
+#include "utils.h"
+
+/**
+ * Returns the current monotonic time in seconds, for timing benchmark runs.
+ * @return Seconds since an arbitrary fixed point.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Times histogram_text_lengths over 1..max_threads threads on one block of text,
+ * reporting throughput so the point where memory bandwidth takes over shows up, and
+ * checks every thread count gives the single-threaded histogram.
+ * @param name Label for the input.
+ * @param text The text to count.
+ * @param size Size of the text in bytes.
+ * @param max_threads Largest thread count to try.
+ */
+static void bench_lengths(const char *name, const char *text, size_t size, int max_threads) {
+    int ref_max;
+    long long ref_lines;
+    long long *reference = histogram_text_lengths(text, size, 1, &ref_max, &ref_lines);
+    if (!reference) return;
+    printf("%s: %.1f MB, %lld lines\n", name, size / 1e6, ref_lines);
+    printf("%-10s %10s %10s %10s %10s\n", "threads", "seconds", "GB/s", "speedup", "identical");
+
+    double single = 0;
+    for (int t = 1; t <= max_threads; t++) {
+        double best = 0;
+        int identical = 1;
+        for (int rep = 0; rep < 3; rep++) { // Best of three
+            int max_length;
+            long long lines;
+            double t0 = now();
+            long long *counts = histogram_text_lengths(text, size, t, &max_length, &lines);
+            double elapsed = now() - t0;
+            if (rep == 0 || elapsed < best) best = elapsed;
+            identical &= counts && max_length == ref_max && lines == ref_lines &&
+                         memcmp(counts, reference, (ref_max + 1) * sizeof(long long)) == 0;
+            free(counts);
+        }
+        if (t == 1) single = best;
+        printf("%-10d %10.4f %10.2f %10.2f %10s\n", t, best, size / best / 1e9, single / best, identical ? "yes" : "NO");
+    }
+    free(reference);
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int repeat = argc > 2 ? atoi(argv[2]) : 200;
+    if (max_threads < 1 || repeat < 1) {
+        fprintf(stderr, "Usage: %s [max threads] [dracula.txt repeats]\n", argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    char *text = map_file("words.txt", &size);
+    if (!text) return 1;
+    bench_lengths("words.txt", text, size, max_threads);
+    unmap_file(text, size);
+
+    // dracula.txt repeated many times, built in memory so the disk doesn't matter
+    char *dracula = map_file("dracula.txt", &size);
+    if (!dracula) return 1;
+    char *corpus = malloc(size * repeat);
+    if (!corpus) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    for (int r = 0; r < repeat; r++) memcpy(corpus + size * r, dracula, size);
+    unmap_file(dracula, size);
+    char name[64];
+    snprintf(name, sizeof(name), "dracula.txt x%d", repeat);
+    printf("\n");
+    bench_lengths(name, corpus, size * repeat, max_threads);
+    free(corpus);
+    return 0;
+}
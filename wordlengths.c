@@ -4,6 +4,30 @@
 #include <string.h>
 #include "histogram.h"
 #include "utils.h"
+#include "wordlengths.h"
+
+#define STREAM_BLOCK_SIZE (64 * 1024) // Bytes read per step in streaming mode
+
+/**
+ * Prints the word length histogram shared by every mode.
+ * Turns the percentages into a bar chart with a title, one bar per length.
+ * @param file_path Name shown in the title.
+ * @param H_double Percentage of words of each length, 0 to max_length.
+ * @param max_length Longest word length.
+ * @return 0 on success, -1 if memory allocation fails.
+ */
+static int print_length_histogram(const char *file_path, double *H_double, int max_length) {
+    // Create an array of indices (0, 1, 2, ..., max_length) for the x-axis
+    int *x = get_indexes(H_double, max_length + 1);
+    if (!x) return -1;
+
+    // Print the histogram with a nice title and labels
+    printf("Word Length Histogram for %s:\n", file_path);
+    printf("Length %% Frequency\n");
+    histogram(x, H_double, max_length + 1, 50);  // 50 sets the bar width
+    free(x);
+    return 0;
+}
 
 /**
  * Prints a histogram showing the distribution of word lengths from a text file.
@@ -12,69 +36,155 @@
  * @param file_path Path to the text file containing words, one per line.
  */
 void wordlengths(char *file_path) {
-    // First, count how many words (lines) are in the file
-    int size = get_file_size(file_path);
-    if (size <= 0) {
+    // Map the file and index its lines in place; each view already knows its length
+    mappedWordList *file = map_word_list(file_path);
+    if (!file) {
         fprintf(stderr, "Error: Could not read file or file is empty\n");
         return;
     }
+    int size = file->count;
 
-    // Load all the words into an array for processing
-    char **file = read_txt_file(file_path, size);
-    if (!file) return;  // Bail out if we couldn’t read the file
-
-    // Build a histogram of word lengths (e.g., how many 3-letter words, etc.)
-    int *H = histogram_lengths(file, size);
+    // Build a histogram of word lengths (e.g., how many 3-letter words, etc.),
+    // which also gives the length of the longest word for the histogram's range
+    int max_length;
+    int *H = histogram_view_lengths(file->words, size, &max_length);
     if (!H) {
-        free_words(file, size);  // Clean up before exiting if this fails
+        free_mapped_word_list(file);  // Clean up before exiting if this fails
         return;
     }
 
-    // Find the length of the longest word to set the histogram’s range
-    int max_length = 0;
-    for (int i = 0; i < size; i++) {
-        int len = strlen(file[i]);
-        if (len > max_length) max_length = len;
-    }
-
     // Allocate space for percentages and convert counts to percentages
     double *H_double = malloc((max_length + 1) * sizeof(double));
     if (!H_double) {
         perror("Memory allocation failed");
         free(H);
-        free_words(file, size);
+        free_mapped_word_list(file);
         return;
     }
     for (int i = 0; i <= max_length; i++) {
         H_double[i] = (H[i] * 100.0) / size;  // Percentage of words with this length
     }
 
-    // Create an array of indices (0, 1, 2, ..., max_length) for the x-axis
-    int *x = get_indexes(H_double, max_length + 1);
-    if (!x) {
-        free(H_double);
-        free(H);
-        free_words(file, size);
+    print_length_histogram(file_path, H_double, max_length);
+
+    // Free up all the memory we used to avoid leaks
+    free(H_double);
+    free(H);
+    free_mapped_word_list(file);
+}
+
+/**
+ * Prints the same word length histogram as wordlengths, but reads the input as a
+ * stream of fixed-size blocks and counts each line's length as its newline goes by.
+ * Every byte is looked at once and memory stays at one block plus one counter per
+ * length, however big the input is, so it works on files larger than RAM and on
+ * pipes. A file path of "-" reads standard input.
+ * @param file_path Path to the text file containing words, one per line, or "-".
+ */
+void wordlengths_stream(char *file_path) {
+    int use_stdin = strcmp(file_path, "-") == 0;
+    FILE *fptr = use_stdin ? stdin : fopen(file_path, "rb");
+    if (!fptr) {
+        perror("Error opening file");
         return;
     }
 
-    // Print the histogram with a nice title and labels
-    printf("Word Length Histogram for %s:\n", file_path);
-    printf("Length %% Frequency\n");
-    histogram(x, H_double, max_length + 1, 50);  // 50 sets the bar width
+    char *block = malloc(STREAM_BLOCK_SIZE);
+    long long capacity = 64, max_length = 0, size = 0, line_len = 0;
+    long long *counts = calloc(capacity, sizeof(long long));
+    if (!block || !counts) {
+        perror("Memory allocation failed");
+        free(block);
+        free(counts);
+        if (!use_stdin) fclose(fptr);
+        return;
+    }
 
-    // Free up all the memory we used to avoid leaks
-    free(x);
+    int failed = 0;
+    size_t got;
+    while (!failed && (got = fread(block, 1, STREAM_BLOCK_SIZE, fptr)) > 0) {
+        char *p = block, *end = block + got, *nl;
+        while ((nl = memchr(p, '\n', end - p))) {
+            line_len += nl - p; // The line may have started in an earlier block
+            if (add_length_count(&counts, &capacity, &max_length, line_len) == -1) { failed = 1; break; }
+            size++;
+            line_len = 0;
+            p = nl + 1;
+        }
+        line_len += end - p; // Carry the unfinished line into the next block
+    }
+    if (ferror(fptr)) {
+        perror("Error reading file");
+        failed = 1;
+    }
+    if (!failed && line_len > 0) { // Last line without a newline
+        failed = add_length_count(&counts, &capacity, &max_length, line_len) == -1;
+        size++;
+    }
+    if (!use_stdin) fclose(fptr);
+    free(block);
+
+    if (!failed && size == 0) fprintf(stderr, "Error: Could not read file or file is empty\n");
+    double *H_double = failed || size == 0 ? NULL : malloc((max_length + 1) * sizeof(double));
+    if (H_double) {
+        for (long long i = 0; i <= max_length; i++) {
+            H_double[i] = (counts[i] * 100.0) / size;  // Percentage of words with this length
+        }
+        print_length_histogram(file_path, H_double, (int)max_length);
+    } else if (!failed && size > 0) {
+        perror("Memory allocation failed");
+    }
+    free(H_double);
+    free(counts);
+}
+
+/**
+ * Prints the same word length histogram as wordlengths, counting with several threads.
+ * The file is mapped and handed to histogram_text_lengths, which splits it on line
+ * boundaries and gives each thread a private histogram to fill; no views are built.
+ * @param file_path Path to the text file containing words, one per line.
+ * @param num_threads Number of threads (0 means one per online CPU).
+ */
+void wordlengths_parallel(char *file_path, int num_threads) {
+    size_t file_size;
+    char *text = map_file(file_path, &file_size);
+    if (!text) {
+        fprintf(stderr, "Error: Could not read file or file is empty\n");
+        return;
+    }
+
+    int max_length;
+    long long size;
+    long long *H = histogram_text_lengths(text, file_size, num_threads, &max_length, &size);
+    unmap_file(text, file_size);
+    if (!H) return;
+
+    double *H_double = malloc((max_length + 1) * sizeof(double));
+    if (!H_double) {
+        perror("Memory allocation failed");
+        free(H);
+        return;
+    }
+    for (int i = 0; i <= max_length; i++) {
+        H_double[i] = (H[i] * 100.0) / size;  // Percentage of words with this length
+    }
+    print_length_histogram(file_path, H_double, max_length);
     free(H_double);
     free(H);
-    free_words(file, size);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
+    int stream = argc == 3 && strcmp(argv[1], "-s") == 0;
+    int threaded = argc == 4 && strcmp(argv[1], "-t") == 0;
+    if (argc != 2 && !stream && !threaded) {
+        fprintf(stderr, "Usage: %s [-s | -t threads] <filename | ->\n", argv[0]);
+        fprintf(stderr, "  -s  stream the input in fixed-size blocks (implied for -, standard input)\n");
+        fprintf(stderr, "  -t  count with this many threads (0 = one per CPU)\n");
         return 1;
     }
-    wordlengths(argv[1]);
+    char *file_path = argv[argc - 1];
+    if (stream || strcmp(file_path, "-") == 0) wordlengths_stream(file_path);
+    else if (threaded) wordlengths_parallel(file_path, atoi(argv[2]));
+    else wordlengths(file_path);
     return 0;  
-}
\ No newline at end of file
+}
@@ -2,5 +2,7 @@
 #define WORDLENGTHS_H
 
 void wordlengths(char *file_path);
+void wordlengths_stream(char *file_path);
+void wordlengths_parallel(char *file_path, int num_threads);
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file